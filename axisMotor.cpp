@@ -1,27 +1,30 @@
 #include "axisMotor.h"
 #include "readSerial.h"
+#include "circuit.h"
+#include "telemetry.h"
+#include "bench.h"
+#include "trace.h"
+#include "messages.h"
 
-axisMotor::axisMotor(motorShield *ms, char axis, uint pin, uint limit, uint rpm, uint steps, uint port) {
+axisMotor::axisMotor(motorShield *ms, uint rpm, uint steps, uint port) {
 
   if ( !ms->hasBegun() )
     ms->begin();
 
   motor = ms->getStepperMotor(port, steps); 
 
+  this->rpm = rpm;
+  this->position = 0.0f;
+  known = tripped = false;
+  corrections = 0;
+  drift = 0.0f;
+
   if ( !motor )
     return;
 
   motor->setSpeed(rpm);
-  this->axis = axis;
-  this->limitPin = pin;
-  this->limit = limit;
   this->direction = FORWARD;
   this->amIHome = false;
-  
-  pinMode(this->limitPin, INPUT);
-
-  // Send the motors home so we're starting from a known position
-  //home();
 
   if ( !cmd )
     cmd = reader->getCmdPtr();
@@ -29,8 +32,19 @@ axisMotor::axisMotor(motorShield *ms, char axis, uint pin, uint limit, uint rpm,
   return;
 }
 
+template <class traits>
+stepperAxis<traits>::stepperAxis(motorShield *ms) : axisMotor(ms, traits::rpm, traits::steps, traits::port) {
+
+  pinMode(traits::pin, INPUT);
+
+  // Send the motors home so we're starting from a known position
+  //home();
+
+  return;
+}
+
+// The stepper belongs to the shield, not to us
 axisMotor::~axisMotor(void) {
-  delete motor;
   return;
 }
 
@@ -45,6 +59,20 @@ void axisMotor::setPosition( float steps ) {
   return;
 }
 
+// The switch is 0. If it went with the count at <expected>, that's how
+// far the count was out (steps lost, or taken that it never saw), so
+// say so and put it right. Before the first time there's nothing to check
+void axisMotor::atSwitch(float expected) {
+  if ( known && fabs(expected) > DRIFT_TOLERANCE ) {
+    drift = expected;
+    corrections++;
+    say(MSG_DRIFT, getAxis(), expected);
+  }
+  position = 0.0f;
+  known = true;
+  return;
+}
+
 void axisMotor::setHome(bool isHome, float pos) {
   this->amIHome = isHome;
   if (amIHome)
@@ -54,15 +82,18 @@ void axisMotor::setHome(bool isHome, float pos) {
     
 }
 
-void axisMotor::home(void) {
+template <class traits>
+void stepperAxis<traits>::home(void) {
 
   if ( !motor ) {
     return;
   }
-  if ( digitalRead(limitPin) == HIGH )
+  if ( onLimit() ) {
+    atSwitch(position);
     return;
+  }
 
-  stepMotor( limit+1, BACKWARD );
+  stepMotor( -((float)traits::limit+1) );
   away();
   position = 0;
   amIHome = true;
@@ -71,67 +102,77 @@ void axisMotor::home(void) {
 
   return;
 }
-bool axisMotor::away( void ) {
+template <class traits>
+bool stepperAxis<traits>::away( void ) {
 
-  if ( digitalRead(limitPin) != HIGH )
+  if ( !onLimit() )
     return true;
 
   if ( !motor ) {
     return false;
   }
 
-  while ( digitalRead(limitPin) == HIGH ) {
+  while ( onLimit() ) {
 
     motor->step(1, FORWARD, MICROSTEP);
 
     // If someone pushed the panic button, stop RIGHT NOW!
+    panicHandler();
     if ( CRASH_STOP ) {
       motor->release();
       return false;
     }
   }
 
-  if ( digitalRead(limitPin) != HIGH ) {
+  if ( !onLimit() ) {
     position = 0;
 #ifdef TEST
-    Serial.println("Off the limit switch");
+    say(MSG_OFF_LIMIT);
 #endif
   }
 
   releaseMotor();
-  return (digitalRead(limitPin) != HIGH);
+  return !onLimit();
 }
 
-void axisMotor::stepMotor(float steps, uint type) {
+template <class traits>
+void stepperAxis<traits>::stepMotor(float steps, uint type) {
+
+  BENCH_START(benchStart);
 
   if ( !motor ) {
 #ifdef TEST
-    Serial.print(F("No such motor on "));Serial.println(axis);
+    say(MSG_NO_AXIS, traits::name);
 #endif
     return;
   }
 
   if ( steps == 0.0 ) {
 #ifdef TEST
-    Serial.println(F("No motion requested"));
+    say(MSG_NO_MOTION);
 #endif
     return;
   }
 
   this->direction = (steps>0.0) ? FORWARD : BACKWARD;
-  steps = fabs(steps);
 
-  // Make sure we're off the limit switch
+  // Make sure we're off the limit switch, checking the count while we're there
+  if ( onLimit() )
+    atSwitch(position);
   away();
 
+  float start = position, target = position + steps;
+  steps = fabs(steps);
+  tripped = false;
+
   // Refuse to allow the screw to move the carriage past it's physical limit
-  if ( direction == FORWARD && steps+position > limit ) {
+  if ( direction == FORWARD && steps+position > traits::limit ) {
     float decimal = steps - (uint)steps;
-    steps = limit - position + decimal;
+    steps = traits::limit - position + decimal;
   }
 
   // Always approach the final posiion from the same direction.... 
-  if ( axis != 'X' && direction == FORWARD )
+  if ( traits::overshoots && direction == FORWARD )
     steps += overshoot;
 
   // Take the major steps....
@@ -141,6 +182,7 @@ void axisMotor::stepMotor(float steps, uint type) {
 
     motor->step(stpSize, direction, type);
     stp += stpSize;
+    TRACEPOINT(traits::name);
 
     // Make sure we need to be keepin' on
     cont = checkContinueStatus();
@@ -153,9 +195,18 @@ void axisMotor::stepMotor(float steps, uint type) {
   if ( cont ) {
 
 
-    if ( axis != 'X' && direction == FORWARD ) {
-      motor->step(overshoot, BACKWARD, type);
-      stp -= overshoot;
+    // Come back from the overshoot a step at a time so a panic isn't kept waiting
+    if ( traits::overshoots && direction == FORWARD ) {
+      int back = 0;
+      while ( back < overshoot ) {
+        motor->step(stpSize, BACKWARD, type);
+        back += stpSize;
+
+        cont = checkContinueStatus();
+        if ( !cont )
+          break;
+      }
+      stp -= back;
     }
 
     // Take the minor (micro) steps to our destination
@@ -176,38 +227,86 @@ void axisMotor::stepMotor(float steps, uint type) {
 
   } // End if ( stp > steps )
 
-  if ( cont )
+  // Stopped by the switch, the count should have got to 0 just then
+  if ( tripped )
+    atSwitch(start + ((direction == FORWARD) ? 1 : -1) * (stp + ustp/100.0));
+  else if ( cont )
     setPosition(stp + ustp/100.0);
   else
     setPosition(0.0f);
 
 #ifdef TEST
-  Serial.print(axis);Serial.print(" took ");Serial.print(stp);Serial.print(" steps ");
-  if ( ustp > 0 ) {
-    Serial.print(", and ");Serial.print(ustp);Serial.print(" microsteps");
-  }
-  Serial.print(" to position ");Serial.println(getPosition());
+  if ( ustp > 0 )
+    say(MSG_MICROSTEPPED, traits::name, stp, ustp, getPosition());
+  else
+    say(MSG_STEPPED, traits::name, stp, getPosition());
 #endif
 
   amIHome = false;
+
+  BENCH_AXIS(traits::name, benchStart);
+
+  // If it only met the switch on the way somewhere, carry on from there
+  if ( tripped && target > 0.0f )
+    stepMotor(target);
   return;
 }
 
-bool axisMotor::checkContinueStatus(void) {
+template <class traits>
+bool stepperAxis<traits>::stepOnce(uint dir) {
+
+  if ( !motor )
+    return false;
+
+  // Held at the physical limit like stepMotor() holds it
+  if ( dir == FORWARD && position + 1 > traits::limit )
+    return true;
 
-  if ( digitalRead(limitPin) == HIGH ) {
+  motor->onestep(dir, DOUBLE);
+  TRACEPOINT(traits::name);
+
+  direction = dir;
+  setPosition(1);
+  amIHome = false;
+
+  float expected = position;
+  tripped = false;
+  bool going = checkContinueStatus();
+  if ( tripped )
+    atSwitch(expected);
+  return going;
+}
+
+template <class traits>
+bool stepperAxis<traits>::checkContinueStatus(void) {
+
+  TRACEPOINT('C');
+
+  // Get the coils off first if the panic button just went
+  panicHandler();
+
+  if ( onLimit() ) {
 #ifdef TEST
-    Serial.println(F("On the limit switch"));
+    say(MSG_ON_LIMIT);
 #endif
+    tripped = true;
     away();
     return false;
   }
 
+  // Keep the host posted while we're on the move
+  bool framed = telem.poll();
+
+  // And get on with the dark baseline ('o'), but not straight after the
+  // frame's photoPin read, back to back ADC reads give bad values
+  if ( controller && !framed )
+    controller->whileMoving();
+
   // Check and see if we need to stop what we're doing
   reader->read();
   if ( cmd->operation == 's' || cmd->operation == 'S' ) {
 #ifdef TEST
-    Serial.println(F("User requested stop"));
+    say(MSG_USER_STOP);
 #endif
     return false;
   }
@@ -215,7 +314,7 @@ bool axisMotor::checkContinueStatus(void) {
   // If someone pushed the panic button, stop RIGHT NOW!
   if ( CRASH_STOP || FATAL_ERROR ) {
 #ifdef TEST
-    Serial.println(F("Something bad is happening"));
+    say(MSG_SOMETHING_BAD);
 #endif
     motor->release();
     return false;
@@ -224,3 +323,8 @@ bool axisMotor::checkContinueStatus(void) {
   return true;
 }
 
+// The four axes motorBoss builds
+template class stepperAxis<xAxis>;
+template class stepperAxis<yAxis>;
+template class stepperAxis<zAxis>;
+template class stepperAxis<rAxis>;
@@ -2,35 +2,74 @@
 #define AXISMOTOR_H
 
 #include "motorShield.h"
+#include "axisTraits.h"
 #include "config.h"
 
+// What motorBoss and friends need of any axis...
 class axisMotor : public Adafruit_StepperMotor {
 
  public:
-  axisMotor           (motorShield *,   char, uint, uint, uint, uint, uint);
-  ~axisMotor          (void);
+  axisMotor           (motorShield *, uint, uint, uint);
+  virtual ~axisMotor  (void);
 
   void  setPosition   (float);
   float getPosition   (void)   {return this->position;}
   bool  getHome       (void)   {return this->amIHome;}
   void  setHome       (bool=true, float=-1.0f);
-  
-  void home           (void);
-  bool away           (void);
 
-  void stepMotor      (float, uint=DOUBLE);
+  virtual char getAxis(void) = 0;
+  virtual void home   (void) = 0;
+  virtual bool away   (void) = 0;
+
+  virtual void stepMotor(float, uint=DOUBLE) = 0;
   void releaseMotor   (void) {motor->release();}
 
- private:
+  // The speed it steps at, config.h's until it's tuned ('u')
+  void  setSpeed      (uint rpm) {this->rpm = rpm; if ( motor ) motor->setSpeed(rpm);}
+  uint  getSpeed      (void)   {return rpm;}
+
+  // Lost steps the limit switch has caught: how many times, and by how
+  // much the count was out the last time ('E')
+  uint16_t getCorrections(void) {return corrections;}
+  float    getDrift      (void) {return drift;}
+  bool     foundSwitch   (void) {return tripped;}   // the last move ended on it
+
+ protected:
   Adafruit_StepperMotor *motor;
 
-  bool checkContinueStatus(void);
   bool  amIHome;
   uint  direction;
-  uint  limitPin;
-  uint  limit;
+  uint  rpm;
   float position;
-  char  axis;
 
-#endif
+  void  atSwitch      (float);
+
+  bool     known;                 // been to the switch, so the count means something
+  bool     tripped;               // the switch stopped the last move
+  uint16_t corrections;
+  float    drift;
+};
+
+// ...and the axis itself, specialised on its traits (axisTraits.h)
+template <class traits> class stepperAxis : public axisMotor {
+
+ public:
+  stepperAxis         (motorShield *);
+
+  char getAxis        (void) {return traits::name;}
+  void home           (void);
+  bool away           (void);
+  void stepMotor      (float, uint=DOUBLE);
+
+  // One whole step and the checks stepMotor() makes after each, for an
+  // axis sharing its time with another (motorBoss::alongside()). False
+  // if it has to stop
+  bool stepOnce       (uint);
+  uint32_t stepTime    (void) {return 60000000UL / ((uint32_t)traits::steps * rpm);}
+
+ private:
+  bool checkContinueStatus(void);
+  bool onLimit        (void) {return pinHigh<traits::pin>();}
 };
+
+#endif
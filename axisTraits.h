@@ -0,0 +1,83 @@
+#ifndef AXISTRAITS_H
+#define AXISTRAITS_H
+
+#include <Arduino.h>
+#include <avr/pgmspace.h>
+#include "config.h"
+
+/*
+ * Everything that's fixed about an axis, from config.h, as compile time
+ * constants. stepperAxis<> is built on one of these, so the limit switch
+ * read, the soft limit and the overshoot policy fold into the step loop
+ * instead of being looked up on every step.
+ */
+struct xAxis {
+  static const char    name       = 'X';
+  static const uint8_t index      = 0;
+  static const uint8_t pin        = XInputPin;
+  static const uint    limit      = XLimit;
+  static const uint    rpm        = xRPM;
+  static const uint    steps      = x_steps_per_revolution;
+  static const uint    port       = xPort;
+  static const bool    overshoots = false;   // plugs straight in
+};
+
+struct yAxis {
+  static const char    name       = 'Y';
+  static const uint8_t index      = 1;
+  static const uint8_t pin        = YInputPin;
+  static const uint    limit      = YLimit;
+  static const uint    rpm        = yRPM;
+  static const uint    steps      = y_steps_per_revolution;
+  static const uint    port       = yPort;
+  static const bool    overshoots = true;
+};
+
+struct zAxis {
+  static const char    name       = 'Z';
+  static const uint8_t index      = 2;
+  static const uint8_t pin        = ZInputPin;
+  static const uint    limit      = ZLimit;
+  static const uint    rpm        = zRPM;
+  static const uint    steps      = z_steps_per_revolution;
+  static const uint    port       = zPort;
+  static const bool    overshoots = true;
+};
+
+struct rAxis {
+  static const char    name       = 'R';
+  static const uint8_t index      = 3;
+  static const uint8_t pin        = RInputPin;
+  static const uint    limit      = RLimit;
+  static const uint    rpm        = rRPM;
+  static const uint    steps      = r_steps_per_revolution;
+  static const uint    port       = rPort;
+  static const bool    overshoots = true;
+};
+
+#define NUM_AXES 4
+
+// Is digital pin <pin> high? On the Uno D0-D7 are PIND, D8-D13 PINB and
+// A0-A5 PINC, so with the pin known at compile time this is a single
+// bit test on the port rather than digitalRead()'s table lookups
+template <uint8_t pin> inline bool pinHigh( void ) {
+#ifdef __AVR__
+  return pin < 8  ? (PIND & _BV(pin)) :
+         pin < 14 ? (PINB & _BV(pin - 8)) : (PINC & _BV(pin - 14));
+#else
+  return digitalRead(pin) == HIGH;
+#endif
+}
+
+// X, Y, Z, R (either case) to their index, anything else to -1
+inline int8_t axisIndex( char axis ) {
+  static const int8_t indices['Z' - 'R' + 1] PROGMEM = {
+    rAxis::index, -1, -1, -1, -1, -1, xAxis::index, yAxis::index, zAxis::index
+  };
+  uint8_t i = (uint8_t)(axis & ~0x20) - 'R';
+  if ( i > 'Z' - 'R' )
+    return -1;
+  return (int8_t)pgm_read_byte(&indices[i]);
+}
+
+#endif
@@ -0,0 +1,55 @@
+#include "bench.h"
+#include "messages.h"
+
+#ifdef BENCH
+#include <avr/pgmspace.h>
+
+benchSlot benchSlots[BENCH_PHASES];
+
+static const char names[BENCH_PHASES][11] PROGMEM = {
+  "X", "Y", "Z", "R",
+  "plugIn", "unPlug",
+  "diodeNoise", "ledAcquire",
+  "serialTx", "fixedDelay"
+};
+
+void benchAdd( byte phase, unsigned long us ) {
+  if ( phase >= BENCH_PHASES )
+    return;
+  benchSlots[phase].count++;
+  benchSlots[phase].total += us;
+  if ( us > benchSlots[phase].max )
+    benchSlots[phase].max = us;
+  return;
+}
+
+// Travel time goes to the axis that did the moving
+void benchAxis( char axis, unsigned long us ) {
+  switch ( axis ) {
+  case 'X': benchAdd(BENCH_X, us); break;
+  case 'Y': benchAdd(BENCH_Y, us); break;
+  case 'Z': benchAdd(BENCH_Z, us); break;
+  case 'R': benchAdd(BENCH_R, us); break;
+  }
+  return;
+}
+
+void benchReset( void ) {
+  memset( (void *)benchSlots, 0, sizeof(benchSlots) );
+  return;
+}
+
+const char *benchName( byte phase, char *name ) {
+  strcpy_P( name, names[phase] );
+  return name;
+}
+
+// 19 <phase> <count> <total us> <max us>, one line per phase
+void benchDump( void ) {
+  char name[11];
+  for ( byte i=0; i<BENCH_PHASES; i++ )
+    say(MSG_BENCH_PHASE, benchName(i, name),
+        benchSlots[i].count, benchSlots[i].total, benchSlots[i].max);
+  return;
+}
+#endif
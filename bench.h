@@ -0,0 +1,42 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Where the time goes in a test. Build with -DBENCH to collect
+// per phase micros() totals, 'j' dumps them and 'J' clears them.
+// Phases nest (plugIn includes its X travel), so totals are inclusive.
+enum benchPhase {
+  BENCH_X, BENCH_Y, BENCH_Z, BENCH_R,
+  BENCH_PLUGIN, BENCH_UNPLUG,
+  BENCH_NOISE, BENCH_LED,
+  BENCH_TX, BENCH_DELAY,
+  BENCH_PHASES
+};
+
+struct benchSlot {
+  unsigned long count;
+  unsigned long total;
+  unsigned long max;
+};
+
+#ifdef BENCH
+extern benchSlot benchSlots[BENCH_PHASES];
+
+void benchAdd     ( byte, unsigned long );
+void benchAxis    ( char, unsigned long );
+void benchReset   ( void );
+void benchDump    ( void );
+const char *benchName( byte, char * );
+
+#define BENCH_START(t)         unsigned long t = micros()
+#define BENCH_STOP(phase, t)   benchAdd(phase, micros() - (t))
+#define BENCH_AXIS(axis, t)    benchAxis(axis, micros() - (t))
+#else
+#define BENCH_START(t)
+#define BENCH_STOP(phase, t)
+#define BENCH_AXIS(axis, t)
+#endif
+
+#endif
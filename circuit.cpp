@@ -1,5 +1,9 @@
 #include "circuit.h"
 #include <elapsedMillis.h>
+#include <avr/eeprom.h>
+#include "bench.h"
+#include "trace.h"
+#include "messages.h"
 
 circuit::circuit(void) {
 
@@ -21,6 +25,12 @@ circuit::circuit(void) {
 
   Snoise = Lnoise = 0.0f;
 
+  prefetch   = false;
+  darkMoving = false;
+  darkReads  = 0;
+  darkL = darkS = 0.0f;
+  darkAt = 0;
+
   // Set the normalization array to zero
   memset( (void *)normalization, 0, 18 * sizeof(float) );
 
@@ -51,6 +61,8 @@ void circuit::roxanne(void) {
 // Write the three bytes to the shift registers
 void circuit::updateRegisters(byte reg[3]) {
 
+  TRACEPOINT('U');
+
   // Open the latch... (prevents updates to the pins)
   digitalWrite(latchPin, LOW);
   byte leds;
@@ -71,7 +83,7 @@ void circuit::updateRegisters(byte reg[3]) {
 } // End void updateRegisters(byte reg[3])
 
 // Turn off the first 18 leds
-inline bool circuit::turnEmOff(void) {
+bool circuit::turnEmOff(void) {
   registers[0] = registers[1] = registers[2] = 0;
   updateRegisters(registers);
 
@@ -138,19 +150,64 @@ void circuit::setRegisters( char input[INPUT_SIZE+2] ) {
   return;
 } // End void setRegisters( char input[INPUT_SIZE+2] )
 
+// Check the photoPin and raise FATAL_ERROR if there's a light leak.
+// Only ever sets the flag, clearing it is left to loop() and sequence()
+bool circuit::lightLeak(void) {
+  uint lightLevel = analogRead(photoPin);
+  if ( lightLevel > maxLightLevel && !FATAL_ERROR ) {
+    FATAL_ERROR = true;
+    say(MSG_LIGHT_LEAK);
+    this->roxanne();
+  }
+  return FATAL_ERROR;
+}
+
+/*
+ * A delay() that spends the ADC settling time between diode reads
+ * watching the photoPin, so a leak is caught within LIGHT_WATCH ms
+ * rather than at the end of the sequence. Back to back analog reads
+ * give bad results, so the photoPin is only read with LIGHT_QUIET ms
+ * gone since the diode read before and LIGHT_QUIET ms still to go
+ * before the next one. The coils stay energized through a sequence,
+ * so it also sees to the panic switch. Returns false on a leak or a
+ * crash stop.
+ */
+bool circuit::watchDelay( uint ms ) {
+  unsigned long start = millis();
+  unsigned long elapsed;
+
+  while ( (elapsed = millis() - start) < ms ) {
+    panicHandler();
+    if ( CRASH_STOP )
+      return false;
+
+    uint left = ms - elapsed, wait = left;
+    if ( elapsed < LIGHT_QUIET )
+      wait = LIGHT_QUIET - elapsed;
+    else if ( left >= LIGHT_QUIET ) {
+      if ( lightLeak() )
+        return false;
+      wait = LIGHT_WATCH;
+    }
+    delay( (left < wait) ? left : wait );
+  }
+  return !FATAL_ERROR;
+}
+
 void circuit::getDiodeNoise(void) {
+  BENCH_START(benchStart);
   Snoise = Lnoise = 0.0f;
 
   // Read once & discard to flush out the diodes
   analogRead(largeDiodePin);
-  delay(5);
+  watchDelay(5);
   analogRead(smallDiodePin);
-  delay(10);
+  watchDelay(10);
 
   // Now, read for reals
   for ( int j=0; j<NUM_SAMPLES; j++ ) {
     Lnoise += analogRead(largeDiodePin); // Arduino hardware issue. Multiple analog reads 
-    delay(5);                            // give random results unless seperated by a few ms
+    watchDelay(5);                       // give random results unless seperated by a few ms
     Snoise += analogRead(smallDiodePin); 
 
     // If someone pushed the panic button, stop RIGHT NOW!
@@ -160,15 +217,90 @@ void circuit::getDiodeNoise(void) {
   Lnoise /= NUM_SAMPLES;
   Snoise /= NUM_SAMPLES;
 
+  BENCH_STOP(BENCH_NOISE, benchStart);
+
+  return;
+}
+
+/*
+ * Called after every motor step ('o' mode), but only reads during a
+ * motorBoss::moveTo() (see darkMove()). The LEDs are dark and the
+ * box is shut while the head moves, so the diodes read there what
+ * getDiodeNoise() would read plugged in, one read at a time whenever
+ * the last is 5 ms old. The steps keep coming and the baseline waits
+ * for the next sequence()
+ */
+void circuit::whileMoving(void) {
+
+  uint16_t wanted = 2 * (NUM_SAMPLES + 1);
+  if ( !prefetch || !darkMoving || !SUBTRACT_NOISE || darkReads >= wanted || millis() - darkAt < 5 )
+    return;
+
+  // Somebody's lit an LED by hand, so it's not dark
+  if ( registers[0] | registers[1] | registers[2] ) {
+    darkReads = 0;
+    return;
+  }
+
+  if ( !darkReads ) {
+    darkL = darkS = 0.0f;
+    updateRegisters(registers);     // latch the LEDs off, whatever the chain holds
+  }
+
+  bool large = !(darkReads % 2);
+  int value = analogRead(large ? largeDiodePin : smallDiodePin);
+  if ( darkReads >= 2 ) {
+    if ( large )
+      darkL += value;
+    else
+      darkS += value;
+  }
+  darkReads++;
+  darkAt = millis();
   return;
 }
 
+// The baseline whileMoving() took, if it's all there and looks like the
+// dark. Either way the next one starts from scratch
+bool circuit::takeDark(void) {
+
+  bool whole = (darkReads >= 2 * (NUM_SAMPLES + 1));
+  darkReads = 0;
+  if ( !whole )
+    return false;
+
+  float L = darkL / NUM_SAMPLES, S = darkS / NUM_SAMPLES;
+  if ( L > DARK_MAX || S > DARK_MAX ) {
+    say(MSG_DARK_HIGH, (int)L, (int)S);
+    return false;
+  }
+  Lnoise = L;
+  Snoise = S;
+  return true;
+}
+
+bool circuit::setPrefetch( bool on ) {
+  prefetch  = on;
+  darkReads = 0;
+  return prefetch;
+}
+
+// A move to a connector starts a fresh baseline, and only its own steps
+// go into it: homing, calibration and tuning runs go anywhere, and
+// plugging in brings the head up to the ODU
+void circuit::darkMove( bool on ) {
+  if ( on )
+    darkReads = 0;
+  darkMoving = on;
+}
+
 void circuit::sequence( void ) {
 
   // Read in the diodes without the LEDs and average the noise
-  // But only one time per connector
+  // But only one time per connector, and not at all if it was
+  // done on the way here
 #ifndef TEST
-  if ( SUBTRACT_NOISE )
+  if ( SUBTRACT_NOISE && !takeDark() )
     getDiodeNoise();
 #else
   Lnoise = Snoise = 0.0f;
@@ -177,23 +309,26 @@ void circuit::sequence( void ) {
   if ( CRASH_STOP || FATAL_ERROR )
     return;
 
-  char msg[40];
   int ran = -1.0;
+  int pd[8];
   
   for ( int i=0; i<NUM_CHANNELS; i++ ) {
     if ( normalization[i] <= 0.0f ) {
-      Serial.println(F("Unknown normalization!"));  
+      say(MSG_NO_NORM);
       normalization[i] = 1.0;
     }
 
     ran = random(1000,9999);
-    sprintf(msg, "c1 %i LED %i",ran, i);
-    Serial.println(msg);
+    BENCH_START(txStart);
+    say(MSG_LED_START, ran, i);
+    BENCH_STOP(BENCH_TX, txStart);
 
     // Initialize the time counter
     elapsedMillis timeElapsed = 0;
     
     /*** Turn the LED on ***/
+    TRACEPOINT('L');
+    BENCH_START(ledStart);
     registers[ (int)(i/8) ] = (1<<(i%8));  
     updateRegisters(registers);
     
@@ -204,14 +339,14 @@ void circuit::sequence( void ) {
 #ifndef TEST
     // Read once & discard to flush out the diodes
     analogRead(largeDiodePin);
-    delay(5);
+    watchDelay(5);
     analogRead(smallDiodePin);
-    delay(5);
+    watchDelay(5);
 #else
     int small = random( 700,800 );
-    delay(5);
+    watchDelay(5);
     int large = normalization[i] * random(0.667*small, 0.90*small);
-    delay(5);
+    watchDelay(5);
 #endif
 
     /*** Turn the LED off ...
@@ -228,14 +363,14 @@ void circuit::sequence( void ) {
       ***/
 #ifndef TEST
       int large = normalization[i] * (analogRead(largeDiodePin) - Lnoise);
-      delay(5);
+      watchDelay(5);
       int small = analogRead(smallDiodePin) - Snoise;  // As above, so below.
-      delay(5);
+      watchDelay(5);
 #else
       int small = random( 700,800 );
-      delay(5);
+      watchDelay(5);
       int large = normalization[i] * random(0.667*small, 0.90*small);
-      delay(5);
+      watchDelay(5);
 #endif
       
       /*** Turn the LED off ...
@@ -247,6 +382,7 @@ void circuit::sequence( void ) {
       small = (small<0) ? 0 : small;
       large = (large<0) ? 0 : large;
 
+      TRACEPOINT('A');
       n++;
       
       Sdelta = small - Smean;
@@ -260,31 +396,41 @@ void circuit::sequence( void ) {
       registers[0] = registers[1] = registers[2];
 
       // If someone pushed the panic button, stop RIGHT NOW!
-      if ( CRASH_STOP || FATAL_ERROR )
+      if ( CRASH_STOP || FATAL_ERROR ) {
+        // Let the Pi know this LED's numbers never made it
+        if ( FATAL_ERROR ) {
+          say(MSG_LED_ABORTED, i);
+        }
         return;
+      }
     }
     turnEmOff();
+    BENCH_STOP(BENCH_LED, ledStart);
 
     float Sstdev = sqrt(Sm2/(n-1));
     float Lstdev = sqrt(Lm2/(n-1));
 
     ran = random(1000,9999);
-    sprintf(msg, "c2 %i PD %i.%i(%i.%i)/%i.%i(%i.%i)",ran,
-        (int)Lmean,  (int)(100*(Lmean  - (int)Lmean)),
-        (int)Lstdev, (int)(100*(Lstdev - (int)Lstdev)),
-        (int)Smean,  (int)(100*(Smean  - (int)Smean)),
-        (int)Sstdev, (int)(100*(Sstdev - (int)Sstdev))
-    );
+    pd[0] = (int)Lmean;  pd[1] = (int)(100*(Lmean  - (int)Lmean));
+    pd[2] = (int)Lstdev; pd[3] = (int)(100*(Lstdev - (int)Lstdev));
+    pd[4] = (int)Smean;  pd[5] = (int)(100*(Smean  - (int)Smean));
+    pd[6] = (int)Sstdev; pd[7] = (int)(100*(Sstdev - (int)Sstdev));
 
     // Pause a moment to give the Pi a chance to process the LED line
     uint temp = (timeElapsed>=LED_DELAY) ? 0 : LED_DELAY-timeElapsed;
-    delay(temp);
+    BENCH_START(delayStart);
+    watchDelay(temp);
+    BENCH_STOP(BENCH_DELAY, delayStart);
 
-    Serial.println(msg);
+    BENCH_START(txStart2);
+    say(MSG_LED_DATA, ran, pd[0], pd[1], pd[2], pd[3], pd[4], pd[5], pd[6], pd[7]);
+    BENCH_STOP(BENCH_TX, txStart2);
 
     // And again to allow it time to run the PD line through
     // before sending the next LED number
-    delay(PD_DELAY);
+    BENCH_START(delayStart2);
+    watchDelay(PD_DELAY);
+    BENCH_STOP(BENCH_DELAY, delayStart2);
     
   } // End for ( int i=0; i<NUM_CHANELS; i++ )
 
@@ -293,13 +439,13 @@ void circuit::sequence( void ) {
   if ( lightLevel > maxLightLevel ) {
     if ( !FATAL_ERROR ) {
       FATAL_ERROR = true;
-      Serial.println(F("fe Fatal Error: Too much light in the box"));
+      say(MSG_LIGHT_LEAK);
       this->roxanne();
     }
   }
   else if ( FATAL_ERROR ) {
     FATAL_ERROR = false;
-    Serial.println(F("ff Fatal Error: light leak cleared"));
+    say(MSG_LEAK_CLEARED);
     this->roxanne();
   }
   
@@ -308,7 +454,7 @@ void circuit::sequence( void ) {
 
 void circuit::calibrate(void) {
 
-  Serial.println(F("c3 Calibrating ... "));
+  say(MSG_CALIBRATING);
 
   turnEmOff();
   int sampleSize = NUM_SAMPLES;
@@ -327,11 +473,11 @@ void circuit::calibrate(void) {
 
 #ifndef TEST
       int small = analogRead(smallDiodePin) - Snoise;
-      delay(5);
+      watchDelay(5);
       int large = analogRead(largeDiodePin) - Lnoise;
 #else
       int small = random(700,800);
-      delay(5);
+      watchDelay(5);
       int large = random( 0.85*small, 0.95*small );
 #endif
       small = (small<0) ? 0 : small;
@@ -340,9 +486,12 @@ void circuit::calibrate(void) {
       Smean += small;
       Lmean += large;
 
-      // If someone pushed the panic button, stop RIGHT NOW!
-      if ( CRASH_STOP )
+      // If someone pushed the panic button, or the lid came
+      // off, stop RIGHT NOW! Don't save a bad calibration
+      if ( CRASH_STOP || FATAL_ERROR ) {
+        turnEmOff();
         return;
+      }
 
     } // End for ( int j=0; j<sampleSize; j++ ) 
     
@@ -363,15 +512,17 @@ void circuit::calibrate(void) {
   // write the calibration constants to EEPROM
   writeData();
 
-  Serial.println(F("c4  Calibrating ... Done."));
+  say(MSG_CALIBRATED);
   
   return;
 } // End calibrate(void)
 
 uint circuit::setSampleSize( int sample_size ) {
 
-  if ( sample_size >= 8 && sample_size <= 2048 )
+  if ( sample_size >= 8 && sample_size <= 2048 ) {
     NUM_SAMPLES = sample_size;
+    darkReads   = 0;
+  }
   return NUM_SAMPLES;
 }
 
@@ -401,75 +552,97 @@ bool circuit::setSubtract( bool subtract ) {
 }
 
 void circuit::dumpNorms(void) {
-  char msg[12] = {0};
   for(int i=0; i<NUM_CHANNELS; i++) {
-    Serial.print(F("normalization["));
-    sprintf(msg, "%i", i);
-    Serial.print(msg);
-    Serial.print(F("] = "));
     int a = (int)normalization[i];
     float b = normalization[i] - a;
     int c = 1000*b;
-    sprintf(msg, "%i.%i", a,c);
-    Serial.println(msg);
+    say(MSG_NORM, i, a, c);
   }
+  say(MSG_CAL_RECORD, (unsigned long)calSequence, calSlot, calChannels, calLnoise, calSnoise);
   return;
 }
 
 
 /********************************* EEPROM Read/Write Functions ************************************/
+static const recordArea calArea = { CAL_BASE, CAL_SLOTS, RECORD_SLOT, CAL_KIND, CAL_VERSION };
+
 void circuit::writeData(void) {
-  int address;
-  const byte size = sizeof(unsigned int);
 
-  for(int i=0; i<NUM_CHANNELS; i++){
-    address = size*i + NUM_CHANNELS*size + ADDRESS_OFFSET;
-    unsigned int value = 1000 * normalization[i];
-    EEPROMWriteInt(address, value);
+  calRecord rec;
+  rec.channels = NUM_CHANNELS;
+  rec.reserved = 0;
+  rec.scale    = CAL_SCALE;
+  rec.Lnoise   = Lnoise;
+  rec.Snoise   = Snoise;
+  for ( int i=0; i<18; i++ ) {
+    float value = CAL_SCALE * normalization[i] + 0.5f;
+    rec.norm[i] = (value >= 65535.0f) ? 65535 : (value <= 0.0f) ? 0 : (uint16_t)value;
   }
 
+  calSlot = recordSave(calArea, &rec, sizeof(rec), &calSequence);
+  if ( calSlot < 0 ) {
+    say(MSG_CAL_NOT_SAVED);
+    return;
+  }
+  calChannels = rec.channels;
+  calLnoise   = Lnoise;
+  calSnoise   = Snoise;
   return;
 }
 
+/*
+ * The newest good calibration record, or failing that the numbers the
+ * firmware used to keep at ADDRESS_OFFSET. Anything it can't vouch for
+ * is said out loud before it falls back to 1.0
+ */
 void circuit::readData(void) {
-  int address;
-  const byte size = sizeof(unsigned int);
-  
-  for(int i=0; i<NUM_CHANNELS; i++){
-    address = size*i + NUM_CHANNELS*size + ADDRESS_OFFSET;
-    unsigned int value = EEPROMReadInt(address);
-    normalization[i] = 0.001 * value;
+
+  calRecord rec;
+  uint8_t corrupt;
+  calSlot     = recordLoad(calArea, &rec, sizeof(rec), &calSequence, &corrupt);
+  calChannels = 0;
+  calLnoise   = calSnoise = 0;
+
+  for ( uint8_t s=0; s<CAL_SLOTS; s++ )
+    if ( corrupt & (1 << s) )
+      say(MSG_CAL_CORRUPT, s);
+
+  if ( calSlot >= 0 && rec.scale ) {
+    for ( int i=0; i<18; i++ )
+      normalization[i] = (float)rec.norm[i] / rec.scale;
+    calChannels = rec.channels;
+    calLnoise   = rec.Lnoise;
+    calSnoise   = rec.Snoise;
   }
+  else if ( readLegacy() )
+    say(MSG_CAL_LEGACY);
 
   bool hollad = false;
   for ( int i=0; i<NUM_CHANNELS; i++ ) {
     if ( normalization[i] <= 0.0 ) {
       normalization[i] = 1.0f;
-      
+
       if ( !hollad ) {
-        Serial.println(F("ff Please run the calibration for the QCBot"));
+        say(MSG_UNCALIBRATED);
         hollad = true;
       }
     }
   }
- 
- return;  
-}
 
-//integer read/write functions found at http://forum.arduino.cc/index.php/topic,37470.0.html
-//This function will write a 2 byte integer to the eeprom at the specified address and address + 1
+  return;
+}
 
-void circuit::EEPROMWriteInt(int p_address, int p_value) {
-  byte lowByte = ((p_value >> 0) & 0xFF);
-  byte highByte = ((p_value >> 8) & 0xFF);
+// 18 words of 1000x at ADDRESS_OFFSET + 36, all or nothing. Erased
+// (0xFFFF) or zeroed cells mean it was never calibrated that way either
+bool circuit::readLegacy(void) {
 
-  EEPROM.write(p_address, lowByte);
-  EEPROM.write(p_address + 1, highByte);
-}
+  uint16_t old[18];
+  eeprom_read_block(old, (const void *)(uintptr_t)(ADDRESS_OFFSET + sizeof(old)), sizeof(old));
+  for ( int i=0; i<18; i++ )
+    if ( old[i] == 0 || old[i] == 0xFFFF )
+      return false;
 
-//This function will read a 2 byte integer from the eeprom at the specified address and address + 1
-unsigned int circuit::EEPROMReadInt(int p_address) {
-  byte lowByte = EEPROM.read(p_address); 
-  byte highByte = EEPROM.read(p_address + 1);
-  return ((lowByte << 0) & 0xFF) + ((highByte << 8)& 0xFF00);
+  for ( int i=0; i<18; i++ )
+    normalization[i] = 0.001 * old[i];
+  return true;
 }
@@ -2,10 +2,19 @@
 #define CIRCUIT_H
 
 #include <Arduino.h>
-#include <EEPROM.h>
 #include "readSerial.h"
+#include "eepromStore.h"
 #include "config.h"
 
+// What calibrate() leaves in EEPROM, one eepromStore record
+struct calRecord {
+  uint8_t  channels;            // how many it measured
+  uint8_t  reserved;
+  uint16_t scale;               // normalization[i] = norm[i] / scale
+  float    Lnoise, Snoise;      // the dark baseline it was taken against
+  uint16_t norm[18];
+} __attribute__((packed));
+
 class circuit {
 
  public:
@@ -29,6 +38,12 @@ class circuit {
   uint    setDelay           ( uint );
   uint    getDelay           ( void ) {return DELAY;}
 
+  // Take the dark baseline for the next sequence() while the head moves,
+  // only between darkMove(true) and darkMove(false) (motorBoss::moveTo())
+  bool    setPrefetch        ( bool );
+  void    darkMove           ( bool );
+  void    whileMoving        ( void );
+
  private:
   bool    allOn;
  
@@ -36,12 +51,16 @@ class circuit {
   void    updateRegisters    ( byte[3] );
 
   void    getDiodeNoise      ( void );
+  bool    takeDark           ( void );
+
+  // Light leak watchdog
+  bool    lightLeak          ( void );
+  bool    watchDelay         ( uint );
 
   // EEPROM read/write utilities
   void    writeData          ( void );
   void    readData           ( void );
-  void    EEPROMWriteInt     ( int, int );
-  uint    EEPROMReadInt      ( int ) ;
+  bool    readLegacy         ( void );
   
   // Three 8-bit shift registers
   byte registers[3];
@@ -55,8 +74,22 @@ class circuit {
   uint PD_DELAY;
 
   float Snoise = 0, Lnoise = 0;
+
+  // The dark baseline whileMoving() is building, reads alternating large
+  // and small with the first pair thrown away like getDiodeNoise() does
+  bool          prefetch;
+  bool          darkMoving;
+  uint16_t      darkReads;
+  float         darkL, darkS;
+  unsigned long darkAt;
   float normalization[18];
 
+  // The calibration record in use, for 'N'
+  uint32_t calSequence;
+  int8_t   calSlot;
+  uint8_t  calChannels;
+  int16_t  calLnoise, calSnoise;
+
 };
-static circuit * controller;
+extern circuit * controller;
 #endif
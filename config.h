@@ -2,7 +2,11 @@
 #define CONFIG_H
 
 // Defs for all
+#ifndef NOTEST
 #define TEST            // Add a load of test routines
+#endif
+//#define BENCH         // Per phase timing totals ('j' to dump)
+//#define TRACE         // Hot path timing ring buffer ('d' to dump)
 
 // Maximum number of steps to allow in software
 #define XLimit 2000
@@ -35,6 +39,16 @@
 #define zRPM 25
 #define rRPM 10
 
+// 'u' tunes an axis up from its speed above: TUNE_CYCLES trips out
+// TUNE_TRAVEL steps and back home at each speed, TUNE_GROWTH percent of
+// that speed faster each round up to TUNE_CEILING times it. The fastest
+// that never lost a step, less TUNE_MARGIN percent, is kept in EEPROM
+#define TUNE_TRAVEL  400
+#define TUNE_CYCLES  3
+#define TUNE_GROWTH  25
+#define TUNE_CEILING 4
+#define TUNE_MARGIN  20
+
 // NEMA 17 motors are 200 steps/revolution
 #define z_steps_per_revolution 200
 #define y_steps_per_revolution 200
@@ -43,7 +57,7 @@
 #define x_steps_per_revolution 2048
 #define r_steps_per_revolution 2048
 
-// Step sizes for the x, y, & z axes in millimeters. Documentation, not used
+// Step sizes for the x, y, & z axes in millimeters. Only the pin clearance uses them
 #define steps_per_millimeter_28BYJ_48   40.0f
 #define steps_per_millimeter_NEMA_17    25.0f
 
@@ -66,15 +80,43 @@
 // For readSerial.h
 #define INPUT_SIZE 32   // Max size of the serial line on the Uno = 64 bytes
 #define BAUD       115200
+#define BAUD_TIMEOUT 2000 // ms to wait for the host to confirm a new baud rate ('B' command)
+
+// For telemetry.h
+#define TELEMETRY_SIZE 64  // Longest status frame, including the \r\n
+#define TELEMETRY_MIN  20  // Fastest frame rate we'll agree to (ms)
 
 // General defines
 typedef unsigned int uint;
-extern bool CRASH_STOP;
+extern volatile bool CRASH_STOP;
 extern bool FATAL_ERROR;
 
-// For the EEPROM write to store the calibration constants (in circuit.cpp)
+// Finish off a panic from the main line (oduqc.cpp)
+void panicHandler(void);
+
+// Where the calibration constants used to go, read once if there's no
+// calibration record yet (in circuit.cpp)
 const int ADDRESS_OFFSET = 50;
 
+// Records kept in EEPROM (eepromStore.h), each kind in its own ring of
+// slots. The Uno has 1 kB; the old layout above ends at 122
+#define RECORD_SLOT      64       // bytes per slot
+#define CAL_KIND         'C'
+#define CAL_VERSION      1
+#define CAL_BASE         128
+#define CAL_SLOTS        3
+#define CAL_SCALE        1000     // normalizations are kept in 1/1000ths
+#define MAP_KIND         'M'      // connector maps (connectorMap.h), odd type then even
+#define MAP_VERSION      1
+#define MAP_BASE         320      // after the calibrations, to 992
+#define MAP_SLOTS        2
+#define MAP_SLOT         168
+#define TUNE_KIND        'S'      // tuned speeds ('u'), ahead of the old layout, to 48
+#define TUNE_VERSION     1
+#define TUNE_BASE        0
+#define TUNE_SLOTS       2
+#define TUNE_SLOT        24
+
 /***********************************************************************************************/
 
 /***
@@ -88,6 +130,9 @@ const int ADDRESS_OFFSET = 50;
   * y_steps_to_connector[0] == HOME
   * types 1 & 3 are listed as y_steps_to_connector[0][...], types 2 & 4
   * are in connectorsPosition[1][...]
+  *
+  * These and the X, Z and R positions below make the built in connector
+  * maps (connectorMap.h), used until a map is written to the EEPROM
   * 
  ***/
 const float y_steps_to_connector[2][20] = {
@@ -108,9 +153,28 @@ const float y_steps_to_connector[2][20] = {
 #define maxLightLevel 24
 #endif
 
+// The most a diode should read in the dark. A baseline taken on the move
+// ('o') that's any higher is thrown away and taken again plugged in
+#define DARK_MAX 100
+
+// How often (ms) the light leak watchdog looks at <photoPin> while
+// the diodes are being sampled, and the quiet (ms) it leaves between
+// that read and the diode reads either side of it
+#define LIGHT_WATCH 5
+#define LIGHT_QUIET 2
+
+// Connectors on the faceplate, and the mask of all of them for the 'F' command
+#define NUM_CONNECTORS 18
+#define ALL_CONNECTORS 0x3FFFFUL
+
 // Always approach from the same direction... this defines the overshoot/return going forward
 #define overshoot 25.0f
 
+// How far (steps) the count can be from 0 when an axis reaches its limit
+// switch before it counts as drift. Coming off the switch leaves the
+// count a fraction of a step behind where the carriage really is
+#define DRIFT_TOLERANCE 2.0f
+
 // For axisMotor.h
 
 // How far is it from the connector in the parking
@@ -124,6 +188,14 @@ const float y_steps_to_connector[2][20] = {
 // while moving and turning. 
 #define plugSteps       500.0f
 
+// How far the alignment pins stand out from the connector face, and a bit
+// more for luck. Sliding ('f') to a connector at the same X, Z and R only
+// backs X off this far, where turning needs all of plugSteps. Measure
+// them on the stand before turning sliding on
+#define pinLength       4.0f     // mm
+#define pinMargin       1.5f     // mm
+#define pinClearSteps   ((pinLength + pinMargin) * steps_per_millimeter_28BYJ_48)
+
 // When calibating the diodes to each other with the acrylic
 // light guide on the ODU platform, this is how far you go 
 // with the connector to just touch the face of the guide
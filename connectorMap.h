@@ -0,0 +1,119 @@
+#ifndef CONNECTORMAP_H
+#define CONNECTORMAP_H
+
+#include <stdint.h>
+#include "config.h"
+
+/*
+ * Where the head goes for each connector, one map per ODU type (odd
+ * 1 & 3, even 2 & 4), kept in EEPROM as an eepromStore record so a stand
+ * can be retuned without a reflash. Entry i is connector i+1, and the
+ * 19th is the calibration position. Each entry is the absolute X, Y, Z
+ * and R steps from home, and bit i of zFirst says connector i+1 is one
+ * that goes high and turns over, so Z moves before R (X, Z, R rather
+ * than X, R, Z).
+ *
+ * Without a record the boss falls back to the built in map made from
+ * the constants in config.h, exactly what it always used.
+ *
+ * Maps go up a line per connector ('W', see oduqc.cpp), in hex so an
+ * entry fits the 32 character line, and 'w' seals the lot only if the
+ * CRC-CCITT the sender worked out over the whole map matches.
+ *
+ * A move is planned from the map alone (planMove()), as the order the
+ * axes go in and where each ends up, and the boss just steps through
+ * it. oduqc_plan builds the same plans for every pair of connectors and
+ * checks them against the rules the order is there for.
+ */
+
+#define MAP_ENTRIES   19          // 18 connectors and the calibration position
+
+struct connectorPos {
+  int16_t x, y, z, r;
+} __attribute__((packed));
+
+struct connectorMap {
+  connectorPos pos[MAP_ENTRIES];
+  uint32_t     zFirst;
+} __attribute__((packed));
+
+#define PLAN_LEGS     4           // one per axis
+
+// Axes as axisIndex() has them (axisTraits.h)
+enum { PLAN_X, PLAN_Y, PLAN_Z, PLAN_R };
+
+struct moveLeg {
+  uint8_t axis;
+  int16_t target;                 // steps from home
+};
+
+struct movePlan {
+  moveLeg leg[PLAN_LEGS];         // in the order they go
+};
+
+inline int16_t axisTarget( const connectorPos &p, uint8_t axis ) {
+  switch ( axis ) {
+  case PLAN_X: return p.x;
+  case PLAN_Y: return p.y;
+  case PLAN_Z: return p.z;
+  }
+  return p.r;
+}
+
+// How to get to <connector> (1-19) of <map>, unplugged: along Y first,
+// then X out to the approach, then Z before R if it's one that goes high
+// and turns over (so it's up clear before it turns), otherwise R before
+// Z (so coming back from one it's turned back before it comes down)
+inline void planMove( const connectorMap &map, uint8_t connector, movePlan *plan ) {
+
+  static const uint8_t rFirst[PLAN_LEGS] = { PLAN_Y, PLAN_X, PLAN_R, PLAN_Z };
+  static const uint8_t zFirst[PLAN_LEGS] = { PLAN_Y, PLAN_X, PLAN_Z, PLAN_R };
+
+  const connectorPos &to = map.pos[connector-1];
+  const uint8_t *order = (map.zFirst & (1UL << (connector-1))) ? zFirst : rFirst;
+  for ( uint8_t i=0; i<PLAN_LEGS; i++ ) {
+    plan->leg[i].axis   = order[i];
+    plan->leg[i].target = axisTarget(to, order[i]);
+  }
+  return;
+}
+
+// Where the constants in config.h put <connector> (1-19) of <type> (1 odd,
+// 2 even); true if it's one that goes Z before R
+inline bool builtInPos( uint8_t type, uint8_t connector, connectorPos *p ) {
+
+  bool odd = (type % 2);
+  p->y = y_steps_to_connector[odd ? 0 : 1][connector];
+  p->x = (connector < 19) ? x_steps_to_odu - plugSteps : calibSteps - plugSteps;
+
+  if ( connector <= 16 ) {
+    p->r = r_steps_to_90;
+    p->z = z_steps_to_low_connectors;
+  }
+  else if ( connector == 19 ) {
+    p->r = r_steps_to_0;
+    p->z = z_steps_to_low_connectors;
+  }
+  // 17 on an odd ODU and 18 on an even one are high and turned over
+  else if ( (connector == 17) == odd ) {
+    p->r = r_steps_to_180;
+    p->z = z_steps_to_high_connectors + z_offset_from_rotation;
+    return true;
+  }
+  else {
+    p->r = r_steps_to_0;
+    p->z = z_steps_to_high_connectors;
+  }
+  return false;
+}
+
+// The whole built in map for <type>
+inline void builtInMap( uint8_t type, connectorMap *map ) {
+  map->zFirst = 0;
+  for ( uint8_t i=0; i<MAP_ENTRIES; i++ )
+    if ( builtInPos(type, i + 1, &map->pos[i]) )
+      map->zFirst |= 1UL << i;
+  return;
+}
+
+#endif
@@ -0,0 +1,181 @@
+#include "eepromStore.h"
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+
+static const uint8_t *slotAddress( const recordArea &area, uint8_t slot ) {
+  return (const uint8_t *)(uintptr_t)(area.base + (uint16_t)slot * area.slotSize);
+}
+
+static uint16_t crcRAM( uint16_t c, const uint8_t *data, uint16_t n ) {
+  while ( n-- )
+    c = _crc_ccitt_update(c, *data++);
+  return c;
+}
+
+// Straight off the EEPROM, so a slot never has to fit on the stack
+static uint16_t crcEEPROM( uint16_t c, const uint8_t *addr, uint16_t n ) {
+  uint8_t buf[16];
+  while ( n ) {
+    uint8_t k = (n > sizeof(buf)) ? sizeof(buf) : n;
+    eeprom_read_block(buf, addr, k);
+    c = crcRAM(c, buf, k);
+    addr += k;
+    n    -= k;
+  }
+  return c;
+}
+
+// Is slot <slot> a good record of this area's? Its header goes in <h>
+static bool checkSlot( const recordArea &area, uint8_t slot, uint8_t length, recordHeader *h, bool *corrupt ) {
+
+  const uint8_t *at = slotAddress(area, slot);
+  eeprom_read_block(h, at, sizeof(*h));
+
+  *corrupt = false;
+  if ( h->kind != area.kind || h->version != area.version || h->length != length )
+    return false;
+
+  uint16_t stored;
+  eeprom_read_block(&stored, at + sizeof(*h) + length, sizeof(stored));
+  *corrupt = (stored != crcEEPROM(0xFFFF, at, sizeof(*h) + length));
+  return !*corrupt;
+}
+
+// The newest good slot, or -1
+static int8_t newest( const recordArea &area, uint8_t length, uint32_t *sequence, uint8_t *corrupt ) {
+
+  int8_t best = -1;
+  uint32_t bestSeq = 0;
+  for ( uint8_t s=0; s<area.slots; s++ ) {
+    recordHeader h;
+    bool bad;
+    if ( checkSlot(area, s, length, &h, &bad) ) {
+      // Sequence numbers can wrap, newer is a small step forward
+      if ( best < 0 || (int32_t)(h.sequence - bestSeq) > 0 ) {
+        best    = s;
+        bestSeq = h.sequence;
+      }
+    }
+    else if ( bad && corrupt )
+      *corrupt |= 1 << s;
+  }
+  if ( sequence )
+    *sequence = bestSeq;
+  return best;
+}
+
+static bool fits( const recordArea &area, uint8_t length ) {
+  return length + RECORD_OVERHEAD <= area.slotSize;
+}
+
+int8_t recordLoad( const recordArea &area, void *payload, uint8_t length, uint32_t *sequence, uint8_t *corrupt ) {
+
+  if ( corrupt )
+    *corrupt = 0;
+  if ( !fits(area, length) )
+    return -1;
+
+  int8_t slot = newest(area, length, sequence, corrupt);
+  if ( slot >= 0 )
+    eeprom_read_block(payload, slotAddress(area, slot) + sizeof(recordHeader), length);
+  return slot;
+}
+
+int8_t recordPeek( const recordArea &area, uint8_t length, uint8_t offset, void *data, uint8_t n, uint32_t *sequence ) {
+
+  if ( !fits(area, length) || offset + n > length )
+    return -1;
+
+  int8_t slot = newest(area, length, sequence, 0x0);
+  if ( slot >= 0 )
+    eeprom_read_block(data, slotAddress(area, slot) + sizeof(recordHeader) + offset, n);
+  return slot;
+}
+
+// Write the header and CRC that make slot <slot>'s payload a record, and check it took
+static bool seal( const recordArea &area, uint8_t slot, uint8_t length, uint32_t sequence ) {
+
+  recordHeader h;
+  h.kind     = area.kind;
+  h.version  = area.version;
+  h.length   = length;
+  h.reserved = 0;
+  h.sequence = sequence;
+
+  uint8_t *at = (uint8_t *)slotAddress(area, slot);
+  uint16_t c = crcEEPROM(crcRAM(0xFFFF, (const uint8_t *)&h, sizeof(h)), at + sizeof(h), length);
+  eeprom_update_block(&h, at, sizeof(h));
+  eeprom_update_block(&c, at + sizeof(h) + length, sizeof(c));
+
+  recordHeader back;
+  bool bad;
+  return checkSlot(area, slot, length, &back, &bad);
+}
+
+int8_t recordSave( const recordArea &area, const void *payload, uint8_t length, uint32_t *sequence ) {
+
+  if ( !fits(area, length) )
+    return -1;
+
+  uint32_t seq;
+  int8_t last = newest(area, length, &seq, 0x0);
+  seq = (last < 0) ? 1 : seq + 1;
+
+  // The next slot round, or the one after that if a cell's gone bad,
+  // but never the newest good record: a save that fails everywhere
+  // else must still leave that one standing
+  uint8_t tries = (last < 0) ? area.slots : area.slots - 1;
+  for ( uint8_t t=0; t<tries; t++ ) {
+    uint8_t slot = (last + 1 + t) % area.slots;
+    uint8_t *at = (uint8_t *)slotAddress(area, slot);
+
+    // Nothing's a record until it's sealed, so break the old one first
+    uint8_t none = 0;
+    eeprom_update_block(&none, at, 1);
+    eeprom_update_block(payload, at + sizeof(recordHeader), length);
+    if ( seal(area, slot, length, seq) ) {
+      if ( sequence )
+        *sequence = seq;
+      return slot;
+    }
+  }
+  return -1;
+}
+
+int8_t recordStage( const recordArea &area, uint8_t length, uint8_t offset, const void *data, uint8_t n ) {
+
+  if ( !fits(area, length) || offset + n > length )
+    return -1;
+
+  int8_t last = newest(area, length, 0x0, 0x0);
+  uint8_t slot = (last + 1) % area.slots;
+  uint8_t *at = (uint8_t *)slotAddress(area, slot);
+
+  uint8_t none = 0;
+  eeprom_update_block(&none, at, 1);
+  eeprom_update_block(data, at + sizeof(recordHeader) + offset, n);
+  return slot;
+}
+
+int8_t recordCommit( const recordArea &area, uint8_t length, uint16_t crc, uint32_t *sequence ) {
+
+  if ( !fits(area, length) )
+    return -1;
+
+  uint32_t seq;
+  int8_t last = newest(area, length, &seq, 0x0);
+  uint8_t slot = (last + 1) % area.slots;
+  if ( crcEEPROM(0xFFFF, slotAddress(area, slot) + sizeof(recordHeader), length) != crc )
+    return -1;
+
+  seq = (last < 0) ? 1 : seq + 1;
+  if ( !seal(area, slot, length, seq) )
+    return -1;
+  if ( sequence )
+    *sequence = seq;
+  return slot;
+}
+
+uint16_t recordCRC( const void *payload, uint8_t length, uint16_t crc ) {
+  return crcRAM(crc, (const uint8_t *)payload, length);
+}
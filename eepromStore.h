@@ -0,0 +1,72 @@
+#ifndef EEPROMSTORE_H
+#define EEPROMSTORE_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/*
+ * Records that survive a reset, kept in a ring of EEPROM slots. Every
+ * save goes to the slot after the newest one, so the writes wear all
+ * the slots evenly instead of the same cells every time, and a save
+ * cut off by a reset leaves the one before it standing. A slot is
+ *
+ *   kind version length 0   1 byte each
+ *   sequence                4 bytes, one more than the record it replaced
+ *   payload                 <length> bytes
+ *   crc                     CRC-CCITT of all of the above
+ *
+ * Loading checks every slot's header and CRC straight off the EEPROM,
+ * keeps those of the right kind and version that check out, and reads
+ * the newest one's payload in one block.
+ *
+ * A record too big to build in RAM can be staged: recordStage() writes
+ * pieces of it into the slot the next save would take (that slot stops
+ * being a record at the first piece), and recordCommit() seals it once
+ * the whole payload's CRC matches the one the sender worked out. This
+ * needs two slots or more, or staging would eat the record in use.
+ */
+
+struct recordArea {
+  uint16_t base;                  // EEPROM address of slot 0
+  uint8_t  slots;
+  uint8_t  slotSize;
+  uint8_t  kind;
+  uint8_t  version;
+};
+
+struct recordHeader {
+  uint8_t  kind;
+  uint8_t  version;
+  uint8_t  length;
+  uint8_t  reserved;
+  uint32_t sequence;
+} __attribute__((packed));
+
+#define RECORD_OVERHEAD (sizeof(recordHeader) + sizeof(uint16_t))
+
+// The slot it came from, or -1 if there's no good record. <corrupt> gets
+// a bit for each slot that had one of these records but a bad CRC
+int8_t recordLoad ( const recordArea &area, void *payload, uint8_t length,
+                    uint32_t *sequence = 0x0, uint8_t *corrupt = 0x0 );
+
+// <n> bytes at <offset> of the newest good record's payload, for records
+// too big to load whole; the slot, or -1
+int8_t recordPeek ( const recordArea &area, uint8_t length, uint8_t offset, void *data, uint8_t n,
+                    uint32_t *sequence = 0x0 );
+
+// The slot it went to (checked by reading it back), or -1 if none but
+// the newest good record's would take it, which is left alone
+int8_t recordSave ( const recordArea &area, const void *payload, uint8_t length,
+                    uint32_t *sequence = 0x0 );
+
+// <n> bytes at <offset> of the staged payload; the slot, or -1
+int8_t recordStage ( const recordArea &area, uint8_t length, uint8_t offset, const void *data, uint8_t n );
+
+// Seal the staged payload if its CRC is <crc>; the slot, or -1
+int8_t recordCommit ( const recordArea &area, uint8_t length, uint16_t crc, uint32_t *sequence = 0x0 );
+
+// The CRC recordCommit() wants for <payload>, or for the next piece of
+// it if <crc> is what the pieces before came to
+uint16_t recordCRC ( const void *payload, uint8_t length, uint16_t crc = 0xFFFF );
+
+#endif
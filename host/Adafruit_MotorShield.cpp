@@ -0,0 +1,66 @@
+#include "Adafruit_MotorShield.h"
+
+Adafruit_MotorShield::Adafruit_MotorShield(uint8_t addr) {
+  _addr = addr;
+}
+
+void Adafruit_MotorShield::begin(uint16_t freq) {
+  return;
+}
+
+Adafruit_StepperMotor *Adafruit_MotorShield::getStepper(uint16_t steps, uint8_t num) {
+  if ( num > 2 )
+    return 0x0;
+
+  num--;
+
+  steppers[num].steppernum = num;
+  steppers[num].revsteps = steps;
+  steppers[num].MC = this;
+  return &steppers[num];
+}
+
+Adafruit_StepperMotor::Adafruit_StepperMotor(void) {
+  revsteps = steppernum = currentstep = 0;
+  usperstep = 0;
+  MC = 0x0;
+}
+
+void Adafruit_StepperMotor::setSpeed(uint16_t rpm) {
+  if ( revsteps && rpm )
+    usperstep = 60000000 / ((uint32_t)revsteps * (uint32_t)rpm);
+}
+
+void Adafruit_StepperMotor::release(void) {
+  if ( MC )
+    HAL->motorRelease(MC->_addr, steppernum + 1);
+}
+
+void Adafruit_StepperMotor::step(uint16_t steps, uint8_t dir, uint8_t style) {
+  uint32_t uspers = usperstep;
+
+  if ( style == INTERLEAVE ) {
+    uspers /= 2;
+  }
+  else if ( style == MICROSTEP ) {
+    uspers /= MICROSTEPS;
+    steps *= MICROSTEPS;
+  }
+
+  while ( steps-- ) {
+    onestep(dir, style);
+    delayMicroseconds(uspers);
+  }
+}
+
+uint8_t Adafruit_StepperMotor::onestep(uint8_t dir, uint8_t style) {
+  if ( MC )
+    HAL->motorStep(MC->_addr, steppernum + 1, dir, style);
+
+  if ( style == MICROSTEP )
+    currentstep += (dir == FORWARD) ? 1 : -1;
+  else
+    currentstep += (dir == FORWARD) ? MICROSTEPS : -MICROSTEPS;
+
+  return currentstep;
+}
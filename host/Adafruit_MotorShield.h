@@ -0,0 +1,58 @@
+#ifndef ADAFRUIT_MOTORSHIELD_H
+#define ADAFRUIT_MOTORSHIELD_H
+
+#include "Arduino.h"
+
+/*
+ * The stepper half of the Adafruit Motor Shield V2 library. Timing
+ * follows the real library (usperstep between coil changes, MICROSTEPS
+ * coil changes per step in MICROSTEP mode); each coil change is handed
+ * to HAL->motorStep() so a simulator can move the axis.
+ */
+#define MICROSTEPS 16
+
+#define FORWARD  1
+#define BACKWARD 2
+#define BRAKE    3
+#define RELEASE  4
+
+#define SINGLE     1
+#define DOUBLE     2
+#define INTERLEAVE 3
+#define MICROSTEP  4
+
+class Adafruit_MotorShield;
+
+class Adafruit_StepperMotor {
+ public:
+  Adafruit_StepperMotor(void);
+  friend class Adafruit_MotorShield;
+
+  void    step(uint16_t steps, uint8_t dir, uint8_t style = SINGLE);
+  void    setSpeed(uint16_t);
+  uint8_t onestep(uint8_t dir, uint8_t style);
+  void    release(void);
+
+  uint32_t usperstep;
+
+ private:
+  uint16_t revsteps;
+  uint8_t  currentstep;
+  uint8_t  steppernum;
+  Adafruit_MotorShield *MC;
+};
+
+class Adafruit_MotorShield {
+ public:
+  Adafruit_MotorShield(uint8_t addr = 0x60);
+  friend class Adafruit_StepperMotor;
+
+  void begin(uint16_t freq = 1600);
+  Adafruit_StepperMotor *getStepper(uint16_t steps, uint8_t num);
+  uint8_t getAddress(void) {return _addr;}
+
+ private:
+  uint8_t _addr;
+  Adafruit_StepperMotor steppers[2];
+};
+#endif
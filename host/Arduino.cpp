@@ -0,0 +1,74 @@
+#include "Arduino.h"
+
+HardwareSerial Serial;
+
+// Stream::readBytes, waits up to the timeout for each character
+size_t HardwareSerial::readBytes(char *buffer, size_t length) {
+  size_t count = 0;
+  while ( count < length ) {
+    unsigned long start = millis();
+    int c;
+    while ( (c = read()) < 0 ) {
+      if ( millis() - start >= timeout )
+        return count;
+      delay(1);
+    }
+    buffer[count++] = (char)c;
+  }
+  return count;
+}
+
+size_t Print::print(long n, int base) {
+  char buffer[34];
+  if ( base == DEC )
+    snprintf(buffer, sizeof(buffer), "%ld", n);
+  else
+    ltoa(n, buffer, base);
+  return write(buffer);
+}
+
+size_t Print::print(unsigned long n, int base) {
+  char buffer[34];
+  if ( base == DEC )
+    snprintf(buffer, sizeof(buffer), "%lu", n);
+  else if ( base == HEX )
+    snprintf(buffer, sizeof(buffer), "%lX", n);
+  else
+    ltoa((long)n, buffer, base);
+  return write(buffer);
+}
+
+size_t Print::print(double number, int digits) {
+  char buffer[48];
+  snprintf(buffer, sizeof(buffer), "%.*f", digits, number);
+  return write(buffer);
+}
+
+char *ltoa(long value, char *str, int base) {
+  static const char digits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+  char tmp[34];
+  char *p = tmp;
+  bool negative = (value < 0 && base == 10);
+  unsigned long v = negative ? -(unsigned long)value : (unsigned long)value;
+
+  if ( base < 2 || base > 36 ) {
+    str[0] = '\0';
+    return str;
+  }
+
+  do {
+    *p++ = digits[v % base];
+    v /= base;
+  } while ( v );
+
+  char *s = str;
+  if ( negative )
+    *s++ = '-';
+  while ( p > tmp )
+    *s++ = *--p;
+  *s = '\0';
+  return str;
+}
+
+char *itoa(int value, char *str, int base)          {return ltoa(value, str, base);}
+char *utoa(unsigned int value, char *str, int base) {return ltoa((long)value, str, base);}
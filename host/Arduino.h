@@ -0,0 +1,126 @@
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+/*
+ * Just enough of the Arduino core for the sketch to build and run
+ * natively. Everything that touches hardware goes through HAL.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "hal.h"
+#include "avr/pgmspace.h"
+
+typedef uint8_t byte;
+typedef bool    boolean;
+typedef uint16_t word;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT        0x0
+#define OUTPUT       0x1
+#define INPUT_PULLUP 0x2
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define CHANGE  1
+#define FALLING 2
+#define RISING  3
+
+#define DEC 10
+#define HEX 16
+
+#define bitRead(value, bit)   (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit)    ((value) |= (1UL << (bit)))
+#define bitClear(value, bit)  ((value) &= ~(1UL << (bit)))
+#define _BV(bit)              (1 << (bit))
+
+#define digitalPinToInterrupt(p) ( (p) == 2 ? 0 : ((p) == 3 ? 1 : -1) )
+
+#define SERIAL_TX_BUFFER_SIZE 64
+#define SERIAL_RX_BUFFER_SIZE 64
+
+inline unsigned long micros(void)               {return HAL->micros();}
+inline unsigned long millis(void)               {return HAL->millis();}
+inline void delay(unsigned long ms)             {HAL->delayMicros(ms * 1000);}
+inline void delayMicroseconds(unsigned int us)  {HAL->delayMicros(us);}
+
+inline void pinMode(uint8_t pin, uint8_t mode)  {HAL->pinMode(pin, mode);}
+inline int  digitalRead(uint8_t pin)            {return HAL->digitalRead(pin);}
+inline void digitalWrite(uint8_t pin, uint8_t v){HAL->digitalWrite(pin, v);}
+inline int  analogRead(uint8_t pin)             {return HAL->analogRead(pin);}
+inline void shiftOut(uint8_t data, uint8_t clock, uint8_t order, uint8_t val) {
+  HAL->shiftOut(data, clock, order, val);
+}
+
+inline void attachInterrupt(uint8_t n, void (*fn)(void), int mode) {HAL->attachInterrupt(n, fn, mode);}
+inline void detachInterrupt(uint8_t n)          {HAL->detachInterrupt(n);}
+inline void noInterrupts(void)                  {}
+inline void interrupts(void)                    {}
+
+// Arduino's WMath on top of avr-libc's generator, so the numbers match the board
+inline void randomSeed(unsigned long seed)      {HAL->randomSeed(seed);}
+inline long random(long howbig)                 {return howbig ? HAL->random() % howbig : 0;}
+inline long random(long howsmall, long howbig) {
+  if ( howsmall >= howbig )
+    return howsmall;
+  return random(howbig - howsmall) + howsmall;
+}
+
+char *itoa(int, char *, int);
+char *ltoa(long, char *, int);
+char *utoa(unsigned int, char *, int);
+
+/******************************** Print/Serial *******************************/
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+class Print {
+ public:
+  virtual ~Print(void) {}
+  virtual size_t write(uint8_t c) {return write(&c, 1);}
+  virtual size_t write(const uint8_t *, size_t) = 0;
+  size_t write(const char *str) {return str ? write((const uint8_t *)str, strlen(str)) : 0;}
+
+  size_t print(const __FlashStringHelper *s) {return write((const char *)s);}
+  size_t print(const char *s)                {return write(s);}
+  size_t print(char c)                       {return write((uint8_t)c);}
+  size_t print(unsigned char n, int b=DEC)   {return print((unsigned long)n, b);}
+  size_t print(int n, int b=DEC)             {return print((long)n, b);}
+  size_t print(unsigned int n, int b=DEC)    {return print((unsigned long)n, b);}
+  size_t print(long, int=DEC);
+  size_t print(unsigned long, int=DEC);
+  size_t print(double, int=2);
+
+  size_t println(void)                       {return write("\r\n");}
+  template <typename T> size_t println(T v)  {size_t n = print(v); return n + println();}
+  template <typename T> size_t println(T v, int b) {size_t n = print(v, b); return n + println();}
+};
+
+class HardwareSerial : public Print {
+ public:
+  void   begin(unsigned long baud)           {HAL->serialBegin(baud);}
+  void   end(void)                           {HAL->serialEnd();}
+  int    available(void)                     {return HAL->serialAvailable();}
+  int    availableForWrite(void)             {return HAL->serialAvailableForWrite();}
+  int    read(void)                          {return HAL->serialRead();}
+  void   flush(void)                         {HAL->serialFlush();}
+  size_t readBytes(char *, size_t);
+  void   setTimeout(unsigned long ms)        {timeout = ms;}
+  operator bool(void)                        {return true;}
+
+  using Print::write;
+  size_t write(const uint8_t *data, size_t len) {return HAL->serialWrite(data, len);}
+
+ private:
+  unsigned long timeout = 1000;
+};
+extern HardwareSerial Serial;
+
+#endif
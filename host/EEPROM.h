@@ -0,0 +1,29 @@
+#ifndef EEPROM_H
+#define EEPROM_H
+
+#include "hal.h"
+
+// The EEPROM library API over the 1 kB image held by HAL
+struct EEPROMClass {
+  uint8_t  read(int idx)                {return (idx >= 0 && idx < length()) ? HAL->eeprom[idx] : 0xFF;}
+  void     write(int idx, uint8_t val)  {HAL->eepromWrite(idx, val);}
+  void     update(int idx, uint8_t val) {if ( read(idx) != val ) write(idx, val);}
+  uint16_t length(void)                 {return sizeof(HAL->eeprom);}
+
+  template <typename T> T &get(int idx, T &t) {
+    uint8_t *ptr = (uint8_t *)&t;
+    for ( int i=0; i<(int)sizeof(T); i++ )
+      ptr[i] = read(idx + i);
+    return t;
+  }
+
+  template <typename T> const T &put(int idx, const T &t) {
+    const uint8_t *ptr = (const uint8_t *)&t;
+    for ( int i=0; i<(int)sizeof(T); i++ )
+      update(idx + i, ptr[i]);
+    return t;
+  }
+};
+
+static EEPROMClass EEPROM;
+#endif
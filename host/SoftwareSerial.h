@@ -0,0 +1,4 @@
+#ifndef SOFTWARESERIAL_H
+#define SOFTWARESERIAL_H
+// Included by readSerial.h but never used, nothing to see here
+#endif
@@ -0,0 +1,31 @@
+#ifndef WIRE_H
+#define WIRE_H
+
+#include "hal.h"
+
+// I2C master writes, handed to HAL one transmission at a time
+class TwoWire {
+ public:
+  void    begin(void)                       {}
+  void    setClock(uint32_t)                {}
+  void    beginTransmission(uint8_t addr)   {address = addr; length = 0;}
+  size_t  write(uint8_t data) {
+    if ( length >= sizeof(buffer) )
+      return 0;
+    buffer[length++] = data;
+    return 1;
+  }
+  uint8_t endTransmission(bool = true) {
+    HAL->i2cWrite(address, buffer, length);
+    length = 0;
+    return 0;
+  }
+
+ private:
+  uint8_t address;
+  uint8_t buffer[32];
+  uint8_t length;
+};
+
+static TwoWire Wire;
+#endif
@@ -0,0 +1,30 @@
+#ifndef AVR_EEPROM_H
+#define AVR_EEPROM_H
+
+// avr-libc's EEPROM block calls over the HAL's image. Addresses are
+// pointers there, as they are on the board
+#include <stddef.h>
+#include <stdint.h>
+#include "hal.h"
+
+static inline uint8_t eeprom_read_byte( const uint8_t *addr ) {
+  uintptr_t a = (uintptr_t)addr;
+  return (a < sizeof(HAL->eeprom)) ? HAL->eeprom[a] : 0xFF;
+}
+
+static inline void eeprom_read_block( void *dst, const void *src, size_t n ) {
+  for ( size_t i=0; i<n; i++ )
+    ((uint8_t *)dst)[i] = eeprom_read_byte((const uint8_t *)src + i);
+}
+
+// Only the bytes that differ are written, which is what saves the cells
+static inline void eeprom_update_block( const void *src, void *dst, size_t n ) {
+  for ( size_t i=0; i<n; i++ ) {
+    uintptr_t a = (uintptr_t)dst + i;
+    uint8_t v = ((const uint8_t *)src)[i];
+    if ( eeprom_read_byte((const uint8_t *)a) != v )
+      HAL->eepromWrite(a, v);
+  }
+}
+
+#endif
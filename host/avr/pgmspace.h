@@ -0,0 +1,21 @@
+#ifndef PGMSPACE_H
+#define PGMSPACE_H
+
+// No separate program space on the host, flash strings are just strings
+#include <string.h>
+#include <stdint.h>
+
+#define PROGMEM
+#define PSTR(s)                (s)
+#define pgm_read_byte(addr)    (*(const uint8_t *)(addr))
+#define pgm_read_word(addr)    (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr)   (*(const uint32_t *)(addr))
+#define pgm_read_ptr(addr)     (*(void * const *)(addr))
+#define memcpy_P               memcpy
+#define strcpy_P               strcpy
+#define strncpy_P              strncpy
+#define strcmp_P               strcmp
+#define strncmp_P              strncmp
+#define strlen_P               strlen
+
+#endif
@@ -0,0 +1,126 @@
+/*
+ * Cycle time benchmarks. Runs the firmware (built with -DBENCH) on the
+ * simulated stand through a fixed set of scenarios and prints where the
+ * virtual time went as a tab separated table:
+ *
+ *   scenario  phase  count  total_us  mean_us  max_us
+ *
+ * One "total" row per scenario gives its end to end time, including the
+ * main loop's idle time between commands. Phases nest (plugIn includes
+ * its X travel), so they don't add up to the total.
+ *
+ *   oduqc_bench [-v] [-i i2c_us] [scenario ...]
+ *
+ * -v echoes the firmware's serial output to stderr.
+ */
+#include <unistd.h>
+#include <string>
+#include "Arduino.h"
+#include "simulator.h"
+#include "../bench.h"
+
+void setup(void);
+void loop(void);
+
+// The simulator, fed from a script instead of stdin
+class benchStand : public simulator {
+ public:
+  benchStand(void) {eof = true; verbose = false;}
+
+  void run(const char *lines) {
+    size_t len = strlen(lines);
+    memcpy(script + scriptLen, lines, len);
+    scriptLen += len;
+    while ( running() ) {
+      idle();
+      loop();
+    }
+  }
+
+  size_t serialWrite(const uint8_t *data, size_t len) {
+    chargeTx(len);
+    if ( verbose )
+      fwrite(data, 1, len, stderr);
+    return len;
+  }
+
+  bool verbose;
+};
+
+struct scenario {
+  const char *name;
+  const char *prep;       // gets the stand into position, not timed
+  const char *measured;
+};
+
+static const scenario scenarios[] = {
+  { "connector",      "T 1\nh\n",    "m 5\ns\n" },
+  { "adjacent",       "T 1\nm 5\n",  "m 6\ns\n" },
+  { "flip_odd",       "T 1\nm 16\n", "m 17\ns\nm 18\ns\n" },
+  { "flip_even",      "T 2\nm 16\n", "m 17\ns\nm 18\ns\n" },
+  { "calibrate",      "T 1\nh\n",    "C\n" },
+  { "odu_type1",      "T 1\nh\n",    "F\n" },
+  { "odu_type2",      "T 2\nh\n",    "F\n" },
+  { "odu_type3",      "T 3\nh\n",    "F\n" },
+  { "odu_type4",      "T 4\nh\n",    "F\n" },
+  { "slide_adjacent", "f 1\nT 1\nm 5\nI\n", "m 6\ns\n" },
+  { "slide_type1",    "f 1\nT 1\nh\n", "F\n" },
+  { "slide_type2",    "f 1\nT 2\nh\n", "F\n" },
+  { "dark_slide1",    "o 1\nf 1\nT 1\nh\n", "F\n" },
+};
+static const int nScenarios = sizeof(scenarios) / sizeof(scenarios[0]);
+
+int main(int argc, char **argv) {
+
+  static benchStand stand;
+
+  int opt;
+  while ( (opt = getopt(argc, argv, "vi:")) != -1 ) {
+    switch ( opt ) {
+    case 'v':
+      stand.verbose = true;
+      break;
+    case 'i':
+      stand.setI2CCost(atoi(optarg));
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-v] [-i i2c_us] [scenario ...]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  HAL = &stand;
+  setup();
+  stand.run("G 1\n");
+
+  printf("scenario\tphase\tcount\ttotal_us\tmean_us\tmax_us\n");
+
+  for ( int s=0; s<nScenarios; s++ ) {
+
+    // Only the scenarios asked for, if any were
+    bool wanted = (optind >= argc);
+    for ( int a=optind; a<argc; a++ )
+      wanted |= !strcmp(argv[a], scenarios[s].name);
+    if ( !wanted )
+      continue;
+
+    stand.run(scenarios[s].prep);
+    benchReset();
+
+    uint32_t start = stand.elapsed();
+    stand.run(scenarios[s].measured);
+    uint32_t total = stand.elapsed() - start;
+
+    char name[11];
+    for ( byte p=0; p<BENCH_PHASES; p++ ) {
+      const benchSlot &slot = benchSlots[p];
+      if ( !slot.count )
+        continue;
+      printf("%s\t%s\t%lu\t%lu\t%lu\t%lu\n", scenarios[s].name, benchName(p, name),
+             slot.count, slot.total, slot.total / slot.count, slot.max);
+    }
+    printf("%s\ttotal\t1\t%u\t%u\t%u\n", scenarios[s].name, total, total, total);
+  }
+
+  return 0;
+}
@@ -0,0 +1,107 @@
+/*
+ * Expands the firmware's terse lines ('v') back into the long form,
+ * using the same message table the firmware is built from. Lines that
+ * aren't terse (already long, telemetry, traces) go through untouched,
+ * so it can sit on any captured log or live on the serial line:
+ *
+ *   oduqc_decode < session.log
+ *
+ * The bytes read and written go to stderr at the end.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define MESSAGES_TABLE_ONLY
+#include "../messages.h"
+
+struct entry {
+  const char *key;
+  bool        bare;
+  const char *format;
+};
+
+#define MSG(name, key, bare, format) { key, bare, format },
+static const entry table[MESSAGES] = {
+  MESSAGE_TABLE
+};
+#undef MSG
+
+// The conversions in a format, in order
+static int conversions(const char *format) {
+  int n = 0;
+  for ( const char *p=format; *p; p++ )
+    if ( *p == '%' )
+      n++;
+  return n;
+}
+
+// Long form of <key> <args...>, or false if the line isn't one of ours
+static bool expand(const std::vector<std::string> &tok, std::string &out) {
+  for ( int i=0; i<MESSAGES; i++ ) {
+    const entry &e = table[i];
+    if ( tok[0] != e.key || conversions(e.format) != (int)tok.size() - 1 )
+      continue;
+
+    out.clear();
+    if ( !e.bare )
+      out.append(e.key, 2).append(" ");
+
+    size_t arg = 1;
+    for ( const char *p=e.format; *p; p++ ) {
+      if ( *p != '%' ) {
+        out += *p;
+        continue;
+      }
+      if ( p[1] == 'l' )
+        p++;
+      p++;
+      out += tok[arg++];
+    }
+    return true;
+  }
+  return false;
+}
+
+int main(int, char **) {
+
+  unsigned long in = 0, outBytes = 0, lines = 0, expanded = 0;
+  char line[1024];
+
+  while ( fgets(line, sizeof(line), stdin) ) {
+    in += strlen(line);
+    lines++;
+
+    // Split on spaces, keeping the line ending to put back
+    std::string text(line);
+    std::string ending;
+    while ( !text.empty() && (text.back() == '\n' || text.back() == '\r') ) {
+      ending.insert(ending.begin(), text.back());
+      text.pop_back();
+    }
+
+    std::vector<std::string> tok;
+    size_t start = 0, sp;
+    while ( (sp = text.find(' ', start)) != std::string::npos ) {
+      tok.push_back(text.substr(start, sp - start));
+      start = sp + 1;
+    }
+    tok.push_back(text.substr(start));
+
+    std::string out;
+    if ( expand(tok, out) )
+      expanded++;
+    else
+      out = text;
+
+    out += ending;
+    fputs(out.c_str(), stdout);
+    fflush(stdout);
+    outBytes += out.size();
+  }
+
+  fprintf(stderr, "decode: %lu lines, %lu expanded, %lu bytes in, %lu bytes out\n",
+          lines, expanded, in, outBytes);
+  return 0;
+}
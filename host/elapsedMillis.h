@@ -0,0 +1,16 @@
+#ifndef ELAPSEDMILLIS_H
+#define ELAPSEDMILLIS_H
+
+#include "Arduino.h"
+
+class elapsedMillis {
+ public:
+  elapsedMillis(void)                  {ms = millis();}
+  elapsedMillis(unsigned long val)     {ms = millis() - val;}
+  operator unsigned long() const       {return millis() - ms;}
+  elapsedMillis &operator=(unsigned long val) {ms = millis() - val; return *this;}
+
+ private:
+  unsigned long ms;
+};
+#endif
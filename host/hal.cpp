@@ -0,0 +1,373 @@
+#include "hal.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <termios.h>
+#include "Arduino.h"
+
+static hal defaultHAL;
+hal *HAL = &defaultHAL;
+
+static uint64_t realMicros(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+hal::hal(void) {
+  fast   = false;
+  now    = 0;
+  epoch  = realMicros();
+  baud   = 0;
+  rng    = 1;
+  forcedSeed = -1;
+  eof    = false;
+  inHead = inTail = 0;
+  rxLast = 0;
+  inFd   = 0;
+  outFd  = 1;
+  gated  = true;
+  slaveFd = -1;
+  ptyLink = 0x0;
+  txFreeAt = 0.0;
+  txBytes  = 0;
+  scriptLen = 0;
+  isr[0] = isr[1] = 0x0;
+  armed[0] = armed[1] = false;
+  eepromFile = 0x0;
+  memset(eeprom, 0xFF, sizeof(eeprom));
+}
+
+/********************************* Clock ************************************/
+uint64_t hal::micros(void) {
+  // Reading the clock isn't free on the board either (micros() is a few
+  // us on the Uno), and charging for it keeps busy-waits from spinning
+  // forever on a virtual clock
+  if ( fast )
+    return now += 4;
+  return realMicros() - epoch;
+}
+
+uint64_t hal::millis(void) {
+  return micros() / 1000;
+}
+
+// The time without charging for looking at it
+uint64_t hal::clock(void) {
+  if ( fast )
+    return now;
+  return realMicros() - epoch;
+}
+
+void hal::delayMicros(uint32_t us) {
+  if ( fast ) {
+    now += us;
+    return;
+  }
+  struct timespec ts = { (time_t)(us / 1000000), (long)(us % 1000000) * 1000 };
+  nanosleep(&ts, 0x0);
+}
+
+/********************************* Pins ************************************/
+// Bit-bang the byte out the same way wiring_shift.c does
+void hal::shiftOut(uint8_t data, uint8_t clock, uint8_t order, uint8_t val) {
+  for ( int i=0; i<8; i++ ) {
+    if ( order == 0 )
+      digitalWrite(data, !!(val & (1 << i)));
+    else
+      digitalWrite(data, !!(val & (1 << (7 - i))));
+    digitalWrite(clock, 1);
+    digitalWrite(clock, 0);
+  }
+}
+
+void hal::attachInterrupt(uint8_t n, void (*fn)(void), int) {
+  if ( n > 1 )
+    return;
+  isr[n] = fn;
+  armed[n] = true;
+}
+
+void hal::detachInterrupt(uint8_t n) {
+  if ( n > 1 )
+    return;
+  armed[n] = false;
+}
+
+// Fire interrupt <n> as if the pin had gone off
+void hal::raiseInterrupt(uint8_t n) {
+  if ( n < 2 && armed[n] && isr[n] )
+    isr[n]();
+}
+
+/****************************** Serial line *********************************/
+// Bytes from a script are already sitting in the RX buffer when loop()
+// looks (the host waited for the last command before sending the next);
+// bytes from a pty come through the UART one character time apart
+void hal::pushInput(const uint8_t *data, size_t len, bool paced) {
+  uint32_t t = clock();
+  if ( (int32_t)(rxLast - t) < 0 )
+    rxLast = t;
+
+  for ( size_t i=0; i<len; i++ ) {
+    size_t next = (inTail + 1) % sizeof(inBuffer);
+    if ( next == inHead )
+      break;
+    if ( paced )
+      rxLast += (uint32_t)byteTime();
+    inBuffer[inTail] = data[i];
+    inArrive[inTail] = paced ? rxLast : t;
+    inTail = next;
+  }
+}
+
+// Pull whatever stdin (or the pty) has for us without blocking
+void hal::pollInput(void) {
+  if ( eof )
+    return;
+
+  if ( !gated ) {
+    uint8_t buf[256];
+    ssize_t n;
+    while ( (n = ::read(inFd, buf, sizeof(buf))) > 0 )
+      pushInput(buf, n, true);
+    // EIO just means nobody has the other end open right now
+    return;
+  }
+
+  struct pollfd pfd = { inFd, POLLIN, 0 };
+  while ( scriptLen < sizeof(script) && poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLIN | POLLHUP)) ) {
+    ssize_t n = ::read(inFd, script + scriptLen, sizeof(script) - scriptLen);
+    if ( n <= 0 ) {
+      eof = true;
+      return;
+    }
+    scriptLen += n;
+  }
+}
+
+void hal::idle(void) {
+  pollInput();
+
+  if ( !gated )
+    return;
+
+  // Don't feed the next line until the last one has been eaten
+  if ( inHead != inTail )
+    return;
+
+  char *nl = (char *)memchr(script, '\n', scriptLen);
+  if ( !nl ) {
+    if ( !eof || !scriptLen )
+      return;
+    nl = script + scriptLen - 1;   // last line without a newline
+  }
+
+  size_t len = nl - script + 1;
+  if ( script[0] == '!' ) {
+    // "!..." lines are for the HAL, not the firmware
+    script[len-1] = '\0';
+    directive(script + 1);
+  }
+  else
+    pushInput((const uint8_t *)script, len, false);
+
+  memmove(script, script + len, scriptLen - len);
+  scriptLen -= len;
+}
+
+// !panic   press the panic button
+// !wait n  sit idle for n ms
+void hal::directive(const char *line) {
+  if ( !strncmp(line, "panic", 5) )
+    raiseInterrupt(0);
+  else if ( !strncmp(line, "wait", 4) )
+    delayMicros(1000UL * atol(line + 4));
+}
+
+bool hal::running(void) {
+  if ( !gated )
+    return !eof;
+  return !eof || scriptLen || inHead != inTail;
+}
+
+// Only count what has made it through the UART by now
+int hal::serialAvailable(void) {
+  if ( !gated )
+    pollInput();
+
+  uint32_t t = clock();
+  int n = 0;
+  for ( size_t i=inHead; i!=inTail; i=(i + 1) % sizeof(inBuffer) ) {
+    if ( (int32_t)(inArrive[i] - t) > 0 )
+      break;
+    n++;
+  }
+  return n;
+}
+
+int hal::serialRead(void) {
+  if ( !serialAvailable() )
+    return -1;
+  uint8_t c = inBuffer[inHead];
+  inHead = (inHead + 1) % sizeof(inBuffer);
+  return c;
+}
+
+// Queue <len> bytes on the UART, waiting whenever the TX buffer is full
+void hal::chargeTx(size_t len) {
+  double bt = byteTime();
+
+  for ( size_t i=0; i<len; i++ ) {
+    double t = clock();
+    if ( txFreeAt - t > (SERIAL_TX_BUFFER_SIZE - 1) * bt ) {
+      delayMicros((uint32_t)(txFreeAt - t - (SERIAL_TX_BUFFER_SIZE - 2) * bt));
+      t = clock();
+    }
+    txFreeAt = ((txFreeAt > t) ? txFreeAt : t) + bt;
+  }
+  txBytes += len;
+}
+
+size_t hal::serialWrite(const uint8_t *data, size_t len) {
+  chargeTx(len);
+  if ( gated )
+    return fwrite(data, 1, len, stdout);
+
+  // Like the UART, nobody listening means the bytes are gone
+  ssize_t n = ::write(outFd, data, len);
+  return (n < 0) ? len : (size_t)n;
+}
+
+void hal::serialFlush(void) {
+  double t = clock();
+  if ( txFreeAt > t )
+    delayMicros((uint32_t)(txFreeAt - t) + 1);
+  if ( gated )
+    fflush(stdout);
+}
+
+int hal::serialAvailableForWrite(void) {
+  double bt = byteTime(), t = clock();
+  int queued = (txFreeAt > t) ? (int)((txFreeAt - t) / bt + 0.999) : 0;
+  return (queued >= SERIAL_TX_BUFFER_SIZE - 1) ? 0 : SERIAL_TX_BUFFER_SIZE - 1 - queued;
+}
+
+int openRawPTY(const char *link, int *slave) {
+  int fd = posix_openpt(O_RDWR | O_NOCTTY);
+  if ( fd < 0 || grantpt(fd) || unlockpt(fd) ) {
+    perror("pty");
+    return -1;
+  }
+  const char *name = ptsname(fd);
+
+  // Raw, like a USB serial port, and held open so the master doesn't
+  // see a hang up every time the host software closes its end
+  *slave = open(name, O_RDWR | O_NOCTTY);
+  if ( *slave < 0 ) {
+    perror(name);
+    close(fd);
+    return -1;
+  }
+  struct termios tio;
+  tcgetattr(*slave, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(*slave, TCSANOW, &tio);
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+  if ( link ) {
+    unlink(link);
+    if ( symlink(name, link) ) {
+      perror(link);
+      close(*slave);
+      close(fd);
+      return -1;
+    }
+  }
+
+  fprintf(stderr, "Serial line on %s%s%s\n", name, link ? " -> " : "", link ? link : "");
+  return fd;
+}
+
+// Open a pseudo-terminal and use it for the serial line from now on.
+// The slave end looks like the board's /dev/ttyACM0 to whatever opens
+// it; <link> (if not null) is made a symlink to it
+bool hal::openPTY(const char *link) {
+  int fd = openRawPTY(link, &slaveFd);
+  if ( fd < 0 )
+    return false;
+
+  ptyLink = link;
+  inFd = outFd = fd;
+  gated = false;
+  eof = false;
+  return true;
+}
+
+void hal::closePTY(void) {
+  if ( gated )
+    return;
+  if ( ptyLink )
+    unlink(ptyLink);
+  close(slaveFd);
+  close(inFd);
+  eof = true;
+}
+
+/********************************* EEPROM ***********************************/
+bool hal::loadEEPROM(const char *file) {
+  eepromFile = file;
+  FILE *fp = fopen(file, "rb");
+  if ( !fp )
+    return false;
+  size_t n = fread(eeprom, 1, sizeof(eeprom), fp);
+  fclose(fp);
+  return n == sizeof(eeprom);
+}
+
+bool hal::saveEEPROM(void) {
+  if ( !eepromFile )
+    return false;
+  FILE *fp = fopen(eepromFile, "wb");
+  if ( !fp )
+    return false;
+  size_t n = fwrite(eeprom, 1, sizeof(eeprom), fp);
+  fclose(fp);
+  return n == sizeof(eeprom);
+}
+
+void hal::eepromWrite(int address, uint8_t value) {
+  if ( address < 0 || address >= (int)sizeof(eeprom) )
+    return;
+  eeprom[address] = value;
+  saveEEPROM();
+}
+
+/********************************* Random ***********************************/
+void hal::randomSeed(uint32_t seed) {
+  if ( forcedSeed >= 0 )
+    seed = forcedSeed;
+  if ( seed )
+    rng = seed;
+}
+
+// avr-libc's random(): Park & Miller minimal standard, via Schrage's method
+int32_t hal::random(void) {
+  int32_t hi, lo, x;
+
+  x = rng;
+  if ( x == 0 )
+    x = 123459876L;
+  hi = x / 127773L;
+  lo = x % 127773L;
+  x = 16807L * lo - 2836L * hi;
+  if ( x < 0 )
+    x += 0x7fffffffL;
+  rng = x;
+  return x;
+}
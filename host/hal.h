@@ -0,0 +1,137 @@
+#ifndef HAL_H
+#define HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Hardware abstraction for the native (Linux) build of the firmware.
+ *
+ * The sketch itself only ever talks to the Arduino core API (Serial,
+ * digitalRead, analogRead, shiftOut, EEPROM, Wire, the motor shield
+ * library and the clock). On the board those come from the Arduino
+ * core; in the host build the replacement headers in this directory
+ * route every one of them through the hal object below. The default
+ * implementation is a quiet, dark stand talking over stdin/stdout or
+ * a pseudo-terminal; anything fancier (a simulator, a recorder) derives
+ * from it and overrides what it needs.
+ *
+ * The serial line is modelled as a UART at the firmware's baud rate:
+ * bytes arrive and leave one character time (10 bits) apart, and
+ * writes wait when the 64 byte TX buffer is full, as on the board.
+ */
+class hal {
+
+ public:
+  hal                          ( void );
+  virtual ~hal                 ( void ) {}
+
+  // Clock. With fast set, time is virtual and delays cost nothing. The
+  // board's 32 bit micros() wraps after 71 minutes, and the firmware's
+  // "micros() - start" gets that right in 32 bit unsigned longs; here an
+  // unsigned long is 64 bits, so the clock doesn't wrap at all
+  virtual uint64_t micros      ( void );
+  uint64_t         millis      ( void );
+  virtual void     delayMicros ( uint32_t );
+  void             setFast     ( bool f ) {fast = f;}
+
+  // Pins
+  virtual void     pinMode     ( uint8_t, uint8_t ) {}
+  virtual int      digitalRead ( uint8_t ) {return 0;}
+  virtual void     digitalWrite( uint8_t, uint8_t ) {}
+  virtual int      analogRead  ( uint8_t ) {return 0;}
+  virtual void     shiftOut    ( uint8_t, uint8_t, uint8_t, uint8_t );
+
+  // The panic switch
+  virtual void     attachInterrupt( uint8_t, void (*)(void), int );
+  virtual void     detachInterrupt( uint8_t );
+  virtual void     raiseInterrupt ( uint8_t );
+
+  // Serial line
+  virtual void     serialBegin ( uint32_t baud ) {this->baud = baud;}
+  virtual void     serialEnd   ( void ) {}
+  virtual int      serialAvailable( void );
+  virtual int      serialRead  ( void );
+  virtual size_t   serialWrite ( const uint8_t *, size_t );
+  virtual void     serialFlush ( void );
+  virtual int      serialAvailableForWrite( void );
+  uint32_t         getBaud     ( void ) {return baud;}
+  uint32_t         getTxBytes  ( void ) {return txBytes;}
+
+  // Talk through a pseudo-terminal instead of stdin/stdout. The slave
+  // end is linked to <link> (if given) for the host software to open
+  bool             openPTY     ( const char * );
+  void             closePTY    ( void );
+
+  // I2C and the steppers hanging off the motor shields
+  virtual void     i2cWrite    ( uint8_t, const uint8_t *, uint8_t ) {}
+  virtual void     motorStep   ( uint8_t, uint8_t, uint8_t, uint8_t ) {}
+  virtual void     motorRelease( uint8_t, uint8_t ) {}
+
+  // 1 kB of EEPROM, erased (0xFF) unless loaded from a file
+  uint8_t          eeprom[1024];
+  bool             loadEEPROM  ( const char * );
+  bool             saveEEPROM  ( void );
+  virtual void     eepromWrite ( int, uint8_t );
+
+  // Random numbers, seeded exactly like avr-libc. forceSeed() makes the
+  // firmware's randomSeed(analogRead(..)) take <seed> whatever the pin
+  // reads, so a replay draws the same c1 nonces and TEST data as the
+  // session it came from
+  virtual void     randomSeed  ( uint32_t seed );
+  void             forceSeed   ( int32_t seed ) {forcedSeed = seed;}
+  int32_t          random      ( void );
+
+  // Called by main() before every loop(). With a script on stdin this
+  // hands the firmware the next line of input, so it behaves like a host
+  // that waits for each command to finish before sending the next. On a
+  // pty, input is passed on as it arrives
+  virtual void     idle        ( void );
+
+  // Keep calling loop() while this is true
+  virtual bool     running     ( void );
+
+ protected:
+  void             pollInput   ( void );
+  virtual void     directive   ( const char * );
+  void             pushInput   ( const uint8_t *, size_t, bool );
+  void             chargeTx    ( size_t );
+  double           byteTime    ( void ) {return 10e6 / (baud ? baud : 115200);}
+  uint64_t         clock       ( void );
+
+  bool             fast;
+  uint64_t         now;        // virtual micros() when fast
+  uint64_t         epoch;      // real micros() at start up
+  uint32_t         baud;
+  uint32_t         rng;
+  int32_t          forcedSeed; // < 0 when the firmware picks
+
+  bool             eof;
+  uint8_t          inBuffer[1024];
+  uint32_t         inArrive[1024]; // when each byte is through the UART
+  size_t           inHead, inTail;
+  uint32_t         rxLast;
+
+  int              inFd, outFd;
+  bool             gated;      // one line per loop(), for scripts
+  int              slaveFd;     // held open so the master never hangs up
+  const char      *ptyLink;
+
+  double           txFreeAt;   // when the TX buffer will be empty
+  uint32_t         txBytes;
+
+  char             script[4096];
+  size_t           scriptLen;
+
+  void           (*isr[2])(void);
+  bool             armed[2];
+
+  const char      *eepromFile;
+};
+
+extern hal *HAL;
+
+// A raw pseudo-terminal whose slave end is held open (in *slave) and
+// linked to <link>. Returns the master, or -1
+int openRawPTY( const char *link, int *slave );
+#endif
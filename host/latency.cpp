@@ -0,0 +1,132 @@
+/*
+ * Stop latency check. Runs the firmware (built with -DNOTEST, so the
+ * sequence really samples the diodes) on the simulated stand, presses
+ * the panic button part way into moves, homing and sequences, and
+ * checks every time that the coils all dropped within the bound:
+ *
+ *   scenario  panic_ms  latency_us
+ *
+ *   oduqc_latency [-v] [-b bound_us] [scenario ...]
+ *
+ * -v echoes the firmware's serial output to stderr. Exits 1 if any
+ * press took longer than <bound_us>, or never released the coils.
+ */
+#include <unistd.h>
+#include "Arduino.h"
+#include "simulator.h"
+#include "../config.h"
+
+void setup(void);
+void loop(void);
+
+// A step loop looks at the switch once a full step (200 a turn), so the
+// bound is one at config.h's slowest speed plus 5 ms for the I2C writes
+static long stopBound(void) {
+  const long rpm[] = { xRPM, yRPM, zRPM, rRPM };
+  long slowest = rpm[0];
+  for ( int i=1; i<4; i++ )
+    if ( rpm[i] < slowest )
+      slowest = rpm[i];
+  return 60000000L / (200L * slowest) + 5000L;
+}
+
+// The simulator, fed from a script instead of stdin
+class latencyStand : public simulator {
+ public:
+  latencyStand(void) {eof = true; verbose = false;}
+
+  void run(const char *lines) {
+    size_t len = strlen(lines);
+    memcpy(script + scriptLen, lines, len);
+    scriptLen += len;
+    while ( running() ) {
+      idle();
+      loop();
+    }
+  }
+
+  size_t serialWrite(const uint8_t *data, size_t len) {
+    chargeTx(len);
+    if ( verbose )
+      fwrite(data, 1, len, stderr);
+    return len;
+  }
+
+  bool verbose;
+};
+
+struct scenario {
+  const char *name;
+  const char *prep;       // gets the stand into position
+  const char *command;    // what the button is pressed during
+  uint32_t    panicMs[4]; // how far into <command>, 0 ends the list
+};
+
+static const scenario scenarios[] = {
+  { "home",     "T 1\nm 5\n",  "h\n",   { 5, 400, 3000, 0 } },
+  { "move",     "T 1\nh\n",    "m 5\n", { 5, 300, 2000, 0 } },
+  { "flip",     "T 1\nm 16\n", "m 17\n", { 100, 1500, 4000, 0 } },
+  { "sequence", "T 1\nm 5\n",  "s\n",   { 40, 1000, 2500, 6000 } },
+};
+static const int nScenarios = sizeof(scenarios) / sizeof(scenarios[0]);
+
+int main(int argc, char **argv) {
+
+  static latencyStand stand;
+  long bound = stopBound();
+
+  int opt;
+  while ( (opt = getopt(argc, argv, "vb:")) != -1 ) {
+    switch ( opt ) {
+    case 'v':
+      stand.verbose = true;
+      break;
+    case 'b':
+      bound = atol(optarg);
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-v] [-b bound_us] [scenario ...]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  HAL = &stand;
+  setup();
+  stand.run("G 1\nC\n");
+
+  printf("scenario\tpanic_ms\tlatency_us\n");
+
+  int failed = 0;
+  for ( int s=0; s<nScenarios; s++ ) {
+
+    // Only the scenarios asked for, if any were
+    bool wanted = (optind >= argc);
+    for ( int a=optind; a<argc; a++ )
+      wanted |= !strcmp(argv[a], scenarios[s].name);
+    if ( !wanted )
+      continue;
+
+    for ( int p=0; p<4 && scenarios[s].panicMs[p]; p++ ) {
+      char press[16];
+      snprintf(press, sizeof(press), "!panic %u\n", scenarios[s].panicMs[p]);
+
+      stand.clearPanic();
+      stand.run(scenarios[s].prep);
+      stand.run(press);
+      stand.run(scenarios[s].command);
+
+      int64_t latency = stand.stopLatency();
+      printf("%s\t%u\t%lld\n", scenarios[s].name, scenarios[s].panicMs[p], (long long)latency);
+      if ( latency < 0 || latency > bound ) {
+        fprintf(stderr, "%s: panic %u ms in %s\n", scenarios[s].name, scenarios[s].panicMs[p],
+                latency < 0 ? "saw no release" : "went over the bound");
+        failed++;
+      }
+
+      // Re-arm the switch for the next press
+      stand.run("c\n");
+    }
+  }
+
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,120 @@
+/*
+ * Native entry point for the firmware. Does what the Arduino core's
+ * main() does, setup() once and loop() forever, with options for
+ * running without a board:
+ *
+ *   -f            virtual clock, delays cost nothing
+ *   -e <file>     keep the EEPROM image in <file>
+ *   -p <link>     serial line on a pseudo-terminal, symlinked to <link>
+ *
+ * and for running against the simulated stand instead of a dead one:
+ *
+ *   -s            simulate the stand (virtual clock)
+ *   -x <speed>    run the clock <speed> x real time (default flat out)
+ *   -c <file>     per channel diode levels, see simulator::loadChannels
+ *   -n <counts>   sigma of the diode noise in ADC counts
+ *   -l <level>    light level in the box
+ *   -L <ms:level> change the light level at <ms> of virtual time
+ *   -i <us>       I2C cost per byte
+ *   -r <seed>     seed for the simulator's noise
+ *
+ * Commands are read from stdin one line per loop(). Lines starting with
+ * '!' go to the HAL instead ("!panic", "!wait <ms>", and with -s
+ * "!light <level>", "!park <axis> <steps>", "!stall <axis> <us>" where
+ * full steps closer together than <us> slip, and "!panic <ms>" to press
+ * the button <ms> into the next command). With -p the stand talks
+ * over the pty instead, at the baud rate the firmware has set, until
+ * it is killed; point the host software at <link> as if it were the
+ * board (e.g. "-p /tmp/oduqc" then open /tmp/oduqc at 115200).
+ */
+#include <unistd.h>
+#include <signal.h>
+#include "Arduino.h"
+#include "simulator.h"
+
+void setup(void);
+void loop(void);
+
+static volatile sig_atomic_t quit = 0;
+static void stop(int) {quit = 1;}
+
+int main(int argc, char **argv) {
+
+  static simulator sim;
+  const char *eeprom = 0x0;
+  const char *pty = 0x0;
+  bool simulate = false;
+  unsigned ms;
+  int level;
+
+  int opt;
+  while ( (opt = getopt(argc, argv, "fe:p:sx:c:n:l:L:i:r:")) != -1 ) {
+    switch ( opt ) {
+    case 'f':
+      HAL->setFast(true);
+      break;
+    case 'e':
+      eeprom = optarg;
+      break;
+    case 'p':
+      pty = optarg;
+      break;
+    case 's':
+      simulate = true;
+      break;
+    case 'x':
+      sim.setSpeed(atof(optarg));
+      break;
+    case 'c':
+      if ( !sim.loadChannels(optarg) ) {
+        fprintf(stderr, "Can't read %s\n", optarg);
+        return 1;
+      }
+      break;
+    case 'n':
+      sim.setNoise(atof(optarg));
+      break;
+    case 'l':
+      sim.setLight(atoi(optarg));
+      break;
+    case 'L':
+      if ( sscanf(optarg, "%u:%d", &ms, &level) != 2 || !sim.scheduleLight(ms, level) ) {
+        fprintf(stderr, "Bad light change %s\n", optarg);
+        return 1;
+      }
+      break;
+    case 'i':
+      sim.setI2CCost(atoi(optarg));
+      break;
+    case 'r':
+      sim.seed(strtoul(optarg, NULL, 0));
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-f] [-e eeprom.bin] [-p link] [-s [-x speed] [-c channels] [-n noise] "
+                      "[-l light] [-L ms:level] [-i i2c_us] [-r seed]]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  if ( simulate )
+    HAL = &sim;
+  if ( eeprom )
+    HAL->loadEEPROM(eeprom);
+  if ( pty && !HAL->openPTY(pty) )
+    return 1;
+
+  signal(SIGINT, stop);
+  signal(SIGTERM, stop);
+
+  setup();
+  while ( !quit && HAL->running() ) {
+    HAL->idle();
+    loop();
+  }
+
+  Serial.flush();
+  HAL->closePTY();
+  if ( simulate )
+    sim.report(stderr);
+  return 0;
+}
@@ -0,0 +1,190 @@
+/*
+ * Session recorder. Sits between the stand and the host software: the
+ * board's serial port on one side, a pseudo-terminal the host software
+ * opens instead of the port on the other. Everything is passed through
+ * untouched and every line either way goes into a session log (see
+ * session.h) with its time, for oduqc_replay to run back through the
+ * native build later.
+ *
+ *   oduqc_record [-b baud] [-p link] -o session.oqs /dev/ttyACM0
+ *
+ * -p symlinks the pty to <link> (say /tmp/oduqc) so the host software
+ * has a fixed name to open. The recorder follows the firmware's 'B'
+ * baud changes on the board side, long or terse: it moves to the new rate
+ * with the host's confirming 'B' and keeps it once the board's second
+ * "15 Baud n" arrives, and goes back on "fc Baud fallback n" or when
+ * neither turns up within BAUD_TIMEOUT. The pty doesn't care about
+ * rates. ^C ends the session.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <string.h>
+#include <asm/termbits.h>
+#include <asm/ioctls.h>
+#include "session.h"
+#include "../config.h"
+
+// <sys/ioctl.h> drags in the glibc termios, which fights termbits.h
+extern "C" int ioctl(int, unsigned long, ...);
+
+int openRawPTY(const char *link, int *slave);
+
+static volatile sig_atomic_t quit = 0;
+static void stop(int) {quit = 1;}
+
+static uint32_t since(const struct timespec &start) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)((ts.tv_sec - start.tv_sec) * 1000000LL + (ts.tv_nsec - start.tv_nsec) / 1000);
+}
+
+// Raw 8N1 at any rate, 250000 included, through termios2
+static bool setLine(int fd, uint32_t baud) {
+  struct termios2 tio;
+  if ( ioctl(fd, TCGETS2, &tio) )
+    return false;
+  tio.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON);
+  tio.c_oflag &= ~OPOST;
+  tio.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+  tio.c_cflag &= ~(CSIZE | PARENB | CBAUD);
+  tio.c_cflag |= CS8 | CLOCAL | CREAD | BOTHER;
+  tio.c_ispeed = tio.c_ospeed = baud;
+  tio.c_cc[VMIN] = 0;
+  tio.c_cc[VTIME] = 0;
+  return !ioctl(fd, TCSETS2, &tio);
+}
+
+static int usage( const char *name ) {
+  fprintf(stderr, "usage: %s [-b baud] [-p link] -o session.oqs /dev/ttyACM0\n", name);
+  return 1;
+}
+
+int main(int argc, char **argv) {
+
+  uint32_t baud = 115200;
+  const char *link = 0x0, *out = 0x0;
+
+  int opt;
+  while ( (opt = getopt(argc, argv, "b:p:o:")) != -1 ) {
+    switch ( opt ) {
+    case 'b':
+      baud = strtoul(optarg, NULL, 0);
+      break;
+    case 'p':
+      link = optarg;
+      break;
+    case 'o':
+      out = optarg;
+      break;
+    default:
+      return usage(argv[0]);
+    }
+  }
+  if ( !out || optind != argc - 1 )
+    return usage(argv[0]);
+
+  int dev = open(argv[optind], O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if ( dev < 0 || !setLine(dev, baud) ) {
+    perror(argv[optind]);
+    return 1;
+  }
+
+  int slave;
+  int pty = openRawPTY(link, &slave);
+  if ( pty < 0 )
+    return 1;
+
+  sessionLog log;
+  if ( !log.create(out, baud) ) {
+    perror(out);
+    return 1;
+  }
+
+  signal(SIGINT, stop);
+  signal(SIGTERM, stop);
+
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  lineSplitter toStand('<'), fromStand('>');
+  unsigned long lines = 0;
+  uint8_t buf[512];
+
+  // A 'B' in flight. The board's first "15 Baud n" comes at the old rate
+  // and it keeps <pending> only if the host's 'B' reaches it at the new
+  // one, so the board side moves with that 'B' and waits for the second
+  // "15" (or goes back if that doesn't come in time)
+  uint32_t pending = 0, pendingAt = 0;
+  bool switched = false;
+
+  while ( !quit ) {
+    struct pollfd pfd[2] = { { dev, POLLIN, 0 }, { pty, POLLIN, 0 } };
+    int ready = poll(pfd, 2, 100);
+
+    if ( pending && since(start) - pendingAt > (BAUD_TIMEOUT + 500) * 1000UL ) {
+      if ( switched )
+        setLine(dev, baud);
+      pending = 0;
+      switched = false;
+    }
+    if ( ready <= 0 )
+      continue;
+
+    // Host to stand
+    ssize_t n;
+    if ( pfd[1].revents & POLLIN && (n = read(pty, buf, sizeof(buf))) > 0 ) {
+      if ( pending && !switched && memchr(buf, 'B', n) && setLine(dev, pending) )
+        switched = true;
+      write(dev, buf, n);
+      toStand.feed(log, since(start), buf, n);
+    }
+
+    // Stand to host. Nobody on the pty just means nobody listening
+    if ( pfd[0].revents & (POLLHUP | POLLERR) ) {
+      fprintf(stderr, "%s went away\n", argv[optind]);
+      break;
+    }
+    if ( pfd[0].revents & POLLIN && (n = read(dev, buf, sizeof(buf))) > 0 ) {
+      write(pty, buf, n);
+      uint32_t t = since(start);
+      for ( ssize_t i=0; i<n; i++ ) {
+        fromStand.feed(log, t, buf + i, 1);
+        if ( buf[i] != '\n' )
+          continue;
+        lines++;
+
+        unsigned long rate;
+        const char *line = fromStand.last.c_str();
+        bool set = sscanf(line, "15 Baud %lu", &rate) == 1 || sscanf(line, "15 %lu", &rate) == 1;
+        bool back = sscanf(line, "fc Baud fallback %lu", &rate) == 1 || sscanf(line, "fc %lu", &rate) == 1;
+
+        // The second "15", at the new rate, or the board went back
+        if ( pending ) {
+          if ( set && switched && rate == pending )
+            baud = pending;
+          else if ( back && switched )
+            setLine(dev, baud);
+          if ( set || back ) {
+            pending = 0;
+            switched = false;
+          }
+        }
+        else if ( set && rate != baud ) {
+          pending = rate;
+          pendingAt = t;
+        }
+      }
+    }
+  }
+
+  log.close();
+  if ( link )
+    unlink(link);
+  fprintf(stderr, "%lu lines from the stand in %s\n", lines, out);
+  return 0;
+}
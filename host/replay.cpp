@@ -0,0 +1,354 @@
+/*
+ * Session replay. Runs a session log (from oduqc_record, or from an
+ * earlier replay's -w) back through the firmware on the simulated stand
+ * and compares what comes out with what the stand said at the time:
+ *
+ *   oduqc_replay [-v] [-r seed] [-w out.oqs] session.oqs
+ *   oduqc_replay -d session.oqs
+ *
+ * Commands are sent the way the host sent them: each one waits until
+ * the replay has produced every line the stand had sent before it, plus
+ * the same think time the host took. Lines that differ are printed as
+ * "-" (recorded) / "+" (replay) pairs; lines that carry times (t1, t2,
+ * t3, 16, 18, 19) are only compared up to their code. Then each command's
+ * response time is printed, recorded against replay:
+ *
+ *   line  command  recorded_ms  replay_ms  change
+ *
+ * The c1 nonces and the TEST data come from random(), seeded on the
+ * board from analogRead(7). Unless -r gives the seed, the replay finds
+ * it by trying every value the ADC can return against the session's
+ * first c1 line. -v echoes the firmware's output, -d just prints the
+ * log. Exits 1 if any line differs.
+ */
+#include <unistd.h>
+#include <sys/wait.h>
+#include "Arduino.h"
+#include "simulator.h"
+#include "session.h"
+
+void setup(void);
+void loop(void);
+
+// Lines whose numbers are times, and so can't match
+static bool timed(const std::string &line) {
+  static const char *codes[] = { "t1", "t2", "t3", "16", "18", "19" };
+  for ( unsigned i=0; i<sizeof(codes)/sizeof(codes[0]); i++ )
+    if ( !line.compare(0, 2, codes[i]) )
+      return true;
+  return false;
+}
+
+static bool same(const std::string &a, const std::string &b) {
+  if ( timed(a) && timed(b) )
+    return !a.compare(0, 2, b, 0, 2);
+  return a == b;
+}
+
+struct replayLine {
+  uint32_t    t;
+  std::string text;
+};
+
+// The simulator, fed from a session log instead of stdin
+class replayStand : public simulator {
+ public:
+  replayStand(const sessionLog &log) : session(log) {
+    eof = true;
+    verbose = false;
+    stopAfter = (size_t)-1;
+    next = 0;
+    outCount = 0;
+    out = 0x0;
+
+    // Give up if it takes twice as long as it did, or a minute over
+    uint32_t length = log.records.empty() ? 0 : log.records.back().t;
+    deadline = (length > 60000000UL) ? 2 * length : length + 60000000UL;
+    findNext();
+  }
+
+  void run(void) {
+    while ( running() ) {
+      idle();
+      loop();
+    }
+  }
+
+  bool running(void) {
+    if ( lines.size() >= stopAfter )
+      return false;
+    if ( now > deadline )
+      return false;
+    return next < session.records.size() || lines.size() < outCount;
+  }
+
+  void idle(void) {
+    feed();
+  }
+
+  int serialAvailable(void) {
+    feed();
+    return simulator::serialAvailable();
+  }
+
+  // Commands due in the middle of a delay arrive in the middle of it
+  void delayMicros(uint32_t us) {
+    uint32_t end = now + us;
+    while ( ready() && (int32_t)(due - end) < 0 ) {
+      if ( (int32_t)(due - now) > 0 )
+        simulator::delayMicros(due - now);
+      feed();
+    }
+    if ( (int32_t)(end - now) > 0 )
+      simulator::delayMicros(end - now);
+  }
+
+  size_t serialWrite(const uint8_t *data, size_t len) {
+    chargeTx(len);
+    if ( verbose )
+      fwrite(data, 1, len, stderr);
+
+    // Stamp each line with when its newline is through the UART
+    for ( size_t i=0; i<len; i++ ) {
+      if ( data[i] == '\n' ) {
+        replayLine line = { (uint32_t)txFreeAt, partial };
+        lines.push_back(line);
+        if ( out )
+          out->add('>', line.t, partial.data(), partial.size());
+        partial.clear();
+      }
+      else if ( data[i] != '\r' )
+        partial += (char)data[i];
+    }
+    return len;
+  }
+
+  const sessionLog        &session;
+  std::vector<replayLine>  lines;      // what the firmware said
+  std::vector<uint32_t>    sent;       // when each command went, by record
+  bool                     verbose;
+  size_t                   stopAfter;  // stop at this many lines
+  sessionLog              *out;
+
+ private:
+  // Move <next> on to the next command, counting the stand's lines we
+  // have to see before it can go
+  void findNext(void) {
+    while ( next < session.records.size() && session.records[next].dir != '<' ) {
+      outCount++;
+      next++;
+    }
+    sent.resize(next + 1, 0);
+  }
+
+  // The next command can go once the lines before it are out, <due>
+  // is then when the host got round to sending it
+  bool ready(void) {
+    if ( next >= session.records.size() || lines.size() < outCount )
+      return false;
+
+    const sessionRecord &rec = session.records[next];
+    if ( next == 0 ) {
+      due = rec.t;
+      return true;
+    }
+    const sessionRecord &prev = session.records[next-1];
+    uint32_t after = (prev.dir == '>') ? lines[outCount-1].t : sent[next-1];
+    due = after + (rec.t - prev.t);
+    return true;
+  }
+
+  void feed(void) {
+    while ( ready() && (int32_t)(due - now) <= 0 ) {
+      const sessionRecord &rec = session.records[next];
+      std::string line = rec.text + "\n";
+      pushInput((const uint8_t *)line.data(), line.size(), true);
+      if ( out )
+        out->add('<', now, rec.text.data(), rec.text.size());
+      sent[next] = now;
+      next++;
+      findNext();
+    }
+  }
+
+  std::string partial;
+  size_t      next;         // next record to send
+  size_t      outCount;     // stand lines before it
+  uint32_t    due;
+  uint32_t    deadline;
+};
+
+// The recorded lines from the stand, in order
+static std::vector<const sessionRecord *> standLines(const sessionLog &log) {
+  std::vector<const sessionRecord *> v;
+  for ( size_t i=0; i<log.records.size(); i++ )
+    if ( log.records[i].dir == '>' )
+      v.push_back(&log.records[i]);
+  return v;
+}
+
+// Boot the firmware on <stand>. A recording that starts after the board
+// booted never saw "00 Ready", so then neither does the comparison
+static void boot(replayStand &stand) {
+  HAL = &stand;
+  setup();
+  if ( stand.session.records.empty() || stand.session.records[0].dir != '>' )
+    stand.lines.clear();
+}
+
+// Does <seed> give the session's first c1 line? Tried in a child so
+// every attempt starts from a freshly booted firmware
+static bool trySeed(const sessionLog &log, size_t c1, int32_t seed) {
+  pid_t pid = fork();
+  if ( pid < 0 )
+    return false;
+  if ( pid == 0 ) {
+    static replayStand stand(log);
+    stand.forceSeed(seed);
+    stand.stopAfter = c1 + 1;
+    boot(stand);
+    stand.run();
+    _exit(stand.lines.size() > c1 && stand.lines[c1].text == standLines(log)[c1]->text ? 0 : 1);
+  }
+  int status;
+  waitpid(pid, &status, 0);
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static int32_t findSeed(const sessionLog &log) {
+  std::vector<const sessionRecord *> stand = standLines(log);
+  size_t c1;
+  for ( c1=0; c1<stand.size(); c1++ )
+    if ( !stand[c1]->text.compare(0, 3, "c1 ") )
+      break;
+  if ( c1 == stand.size() )
+    return 0;
+
+  // randomSeed(0) leaves the seed alone, so 1 covers 0 too
+  for ( int32_t seed=1; seed<1024; seed++ )
+    if ( trySeed(log, c1, seed) )
+      return seed;
+  return -1;
+}
+
+static void dump(const sessionLog &log) {
+  printf("# baud %u\n", log.baud);
+  for ( size_t i=0; i<log.records.size(); i++ )
+    printf("%10.3f %c %s\n", log.records[i].t / 1e3, log.records[i].dir, log.records[i].text.c_str());
+}
+
+static int usage( const char *name ) {
+  fprintf(stderr, "usage: %s [-v] [-r seed] [-w out.oqs] session.oqs\n"
+                  "       %s -d session.oqs\n", name, name);
+  return 2;
+}
+
+int main(int argc, char **argv) {
+
+  bool verbose = false, dumpOnly = false;
+  int32_t seed = -1;
+  const char *write = 0x0;
+
+  int opt;
+  while ( (opt = getopt(argc, argv, "vdr:w:")) != -1 ) {
+    switch ( opt ) {
+    case 'v':
+      verbose = true;
+      break;
+    case 'd':
+      dumpOnly = true;
+      break;
+    case 'r':
+      seed = strtoul(optarg, NULL, 0);
+      break;
+    case 'w':
+      write = optarg;
+      break;
+    default:
+      return usage(argv[0]);
+    }
+  }
+  if ( optind != argc - 1 )
+    return usage(argv[0]);
+
+  static sessionLog log;
+  if ( !log.load(argv[optind]) ) {
+    fprintf(stderr, "Can't read session %s\n", argv[optind]);
+    return 2;
+  }
+  if ( dumpOnly ) {
+    dump(log);
+    return 0;
+  }
+
+  if ( seed < 0 ) {
+    seed = findSeed(log);
+    if ( seed < 0 ) {
+      fprintf(stderr, "No seed gives the recorded c1 nonces, replaying with 1\n");
+      seed = 1;
+    }
+  }
+
+  static replayStand stand(log);
+  static sessionLog out;
+  if ( write && !out.create(write, log.baud) ) {
+    perror(write);
+    return 2;
+  }
+  stand.verbose = verbose;
+  stand.out = write ? &out : 0x0;
+  stand.forceSeed(seed);
+  boot(stand);
+  stand.run();
+  Serial.flush();
+  out.close();
+
+  // Line by line
+  std::vector<const sessionRecord *> recorded = standLines(log);
+  size_t n = (recorded.size() > stand.lines.size()) ? recorded.size() : stand.lines.size();
+  unsigned differ = 0;
+  for ( size_t i=0; i<n; i++ ) {
+    bool haveRec = i < recorded.size(), haveNew = i < stand.lines.size();
+    if ( haveRec && haveNew && same(recorded[i]->text, stand.lines[i].text) )
+      continue;
+    differ++;
+    if ( haveRec )
+      printf("- %zu %s\n", i + 1, recorded[i]->text.c_str());
+    if ( haveNew )
+      printf("+ %zu %s\n", i + 1, stand.lines[i].text.c_str());
+  }
+
+  // Command by command: from sending it to the last line before the next
+  printf("line\tcommand\trecorded_ms\treplay_ms\tchange\n");
+  size_t line = 0;
+  uint32_t recEnd = 0, newEnd = 0;
+  for ( size_t r=0; r<log.records.size(); r++ ) {
+    if ( log.records[r].dir != '<' ) {
+      line++;
+      continue;
+    }
+
+    size_t last = line;
+    for ( size_t k=r+1; k<log.records.size() && log.records[k].dir == '>'; k++ )
+      last++;
+    if ( r >= stand.sent.size() || (last > line && last > stand.lines.size()) )
+      break;
+
+    double recMs = 0.0, newMs = 0.0;
+    if ( last > line ) {
+      recMs = (recorded[last-1]->t - log.records[r].t) / 1e3;
+      newMs = (stand.lines[last-1].t - stand.sent[r]) / 1e3;
+      recEnd = recorded[last-1]->t;
+      newEnd = stand.lines[last-1].t;
+    }
+    printf("%zu\t%s\t%.1f\t%.1f\t%+.1f%%\n", r + 1, log.records[r].text.c_str(), recMs, newMs,
+           recMs ? 100.0 * (newMs - recMs) / recMs : 0.0);
+  }
+
+  printf("session\ttotal\t%.1f\t%.1f\t%+.1f%%\n", recEnd / 1e3, newEnd / 1e3,
+         recEnd ? 100.0 * ((double)newEnd - recEnd) / recEnd : 0.0);
+  fprintf(stderr, "replay: seed %d, %zu lines recorded, %zu replayed, %u differ\n",
+          seed, recorded.size(), stand.lines.size(), differ);
+
+  return differ ? 1 : 0;
+}
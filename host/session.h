@@ -0,0 +1,157 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+/*
+ * Serial session logs. One file per session:
+ *
+ *   "OQS1"  magic
+ *   u32     baud rate at the start, little endian
+ *
+ * then one record per line that crossed the wire:
+ *
+ *   u8      direction, '<' host to stand, '>' stand to host
+ *   varint  microseconds since the previous record
+ *   varint  length of the line
+ *   bytes   the line, without its \r\n
+ *
+ * Varints are LEB128 (7 bits a byte, low bits first), so a typical c2
+ * line costs 3 or 4 bytes on top of its text. Times are when the line's
+ * newline went past, which is when the other end could act on it.
+ */
+
+#define SESSION_MAGIC "OQS1"
+
+struct sessionRecord {
+  char        dir;
+  uint32_t    t;          // us since the start of the session
+  std::string text;
+};
+
+class sessionLog {
+
+ public:
+  sessionLog(void) {fp = 0x0; last = 0; baud = 115200;}
+  ~sessionLog(void) {close();}
+
+  bool create(const char *file, uint32_t rate) {
+    fp = fopen(file, "wb");
+    if ( !fp )
+      return false;
+    fwrite(SESSION_MAGIC, 1, 4, fp);
+    for ( int i=0; i<4; i++ )
+      fputc((rate >> (8 * i)) & 0xFF, fp);
+    baud = rate;
+    last = 0;
+    return true;
+  }
+
+  // Append a line, flushed so a killed recorder still leaves a log
+  void add(char dir, uint32_t t, const char *text, size_t len) {
+    if ( !fp )
+      return;
+    fputc(dir, fp);
+    putVarint(t - last);
+    putVarint(len);
+    fwrite(text, 1, len, fp);
+    fflush(fp);
+    last = t;
+  }
+
+  void close(void) {
+    if ( fp )
+      fclose(fp);
+    fp = 0x0;
+  }
+
+  bool load(const char *file) {
+    FILE *in = fopen(file, "rb");
+    if ( !in )
+      return false;
+
+    char magic[4];
+    uint8_t rate[4];
+    if ( fread(magic, 1, 4, in) != 4 || memcmp(magic, SESSION_MAGIC, 4) || fread(rate, 1, 4, in) != 4 ) {
+      fclose(in);
+      return false;
+    }
+    baud = rate[0] | rate[1] << 8 | rate[2] << 16 | (uint32_t)rate[3] << 24;
+
+    records.clear();
+    uint32_t t = 0, dt, len;
+    int dir;
+    while ( (dir = fgetc(in)) != EOF ) {
+      if ( !getVarint(in, &dt) || !getVarint(in, &len) )
+        break;
+      sessionRecord rec;
+      rec.dir = dir;
+      rec.t = (t += dt);
+      rec.text.resize(len);
+      if ( len && fread(&rec.text[0], 1, len, in) != len )
+        break;
+      records.push_back(rec);
+    }
+    fclose(in);
+    return true;
+  }
+
+  uint32_t                   baud;
+  std::vector<sessionRecord> records;
+
+ private:
+  void putVarint(uint32_t v) {
+    while ( v >= 0x80 ) {
+      fputc((v & 0x7F) | 0x80, fp);
+      v >>= 7;
+    }
+    fputc(v, fp);
+  }
+
+  static bool getVarint(FILE *in, uint32_t *v) {
+    *v = 0;
+    for ( int shift=0; shift<35; shift+=7 ) {
+      int c = fgetc(in);
+      if ( c == EOF )
+        return false;
+      *v |= (uint32_t)(c & 0x7F) << shift;
+      if ( !(c & 0x80) )
+        return true;
+    }
+    return false;
+  }
+
+  FILE     *fp;
+  uint32_t  last;
+};
+
+// Cuts one direction of the byte stream into lines for the log
+class lineSplitter {
+
+ public:
+  lineSplitter(char d) {dir = d;}
+
+  void feed(sessionLog &log, uint32_t t, const uint8_t *data, size_t len) {
+    for ( size_t i=0; i<len; i++ ) {
+      if ( data[i] == '\n' ) {
+        log.add(dir, t, line.data(), line.size());
+        last.swap(line);
+        line.clear();
+      }
+      else if ( data[i] != '\r' )
+        line += (char)data[i];
+    }
+  }
+
+  std::string line;       // the line so far
+  std::string last;       // the last one finished
+
+ private:
+  char dir;
+};
+
+#endif
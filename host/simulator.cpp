@@ -0,0 +1,331 @@
+#include "simulator.h"
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "../config.h"
+#include "Adafruit_MotorShield.h"
+
+// What things cost on the Uno, in us
+#define ADC_CONVERSION   112    // 13 ADC clocks at 125 kHz
+#define SHIFT_BYTE       100    // shiftOut() bit-banging one byte
+#define PWM_WRITE_BYTES  6      // address, register and 4 bytes per PCA9685 channel
+#define COIL_WRITES      6      // setPWM x2 + setPin x4 per onestep()
+
+static uint64_t realMicros(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+simulator::simulator(void) {
+  const char    names[SIM_AXES]  = {'X', 'Y', 'Z', 'R'};
+  const uint8_t shield[SIM_AXES] = {0x61, 0x60, 0x60, 0x61};
+  const uint8_t port[SIM_AXES]   = {xPort, yPort, zPort, rPort};
+  const uint8_t pin[SIM_AXES]    = {XInputPin, YInputPin, ZInputPin, RInputPin};
+  const int32_t limit[SIM_AXES]  = {XLimit, YLimit, ZLimit, RLimit};
+
+  for ( int i=0; i<SIM_AXES; i++ ) {
+    axes[i].name        = names[i];
+    axes[i].shield      = shield[i];
+    axes[i].port        = port[i];
+    axes[i].pin         = pin[i];
+    axes[i].minStop     = -20 * MICROSTEPS;                  // the switch lever has a bit of travel
+    axes[i].maxStop     = (limit[i] + 100) * MICROSTEPS;
+    axes[i].position    = axes[i].maxStop / 3;               // parked somewhere in the middle
+    axes[i].energized   = false;
+    axes[i].coilChanges = 0;
+    axes[i].lost        = 0;
+    axes[i].stallUs     = 0;
+    axes[i].lastStep    = 0;
+  }
+
+  // Every channel sees about the same light, large diode a bit dimmer
+  for ( int i=0; i<SIM_CHANNELS; i++ ) {
+    channels[i].small = 750.0f;
+    channels[i].large = 600.0f;
+  }
+
+  fast       = true;
+  speed      = 0.0f;
+  noise      = 5.0f;
+  light      = 3;
+  dark       = 8;
+  i2cByte    = 90;              // 9 bits at 100 kHz
+  realStart  = realMicros();
+  nShifted   = 0;
+  lit        = 0;
+  nEvents    = 0;
+  panicAt    = releasedAt = panicDue = 0;
+  noiseState = 0x9E3779B97F4A7C15ULL;
+}
+
+void simulator::seed(uint32_t s) {
+  noiseState = 0x9E3779B97F4A7C15ULL ^ s;
+}
+
+/*
+ * Channel file, one line per LED: <led> <large> <small>, the ADC counts
+ * each diode reads with that LED lit. '#' starts a comment.
+ */
+bool simulator::loadChannels(const char *file) {
+  FILE *fp = fopen(file, "r");
+  if ( !fp )
+    return false;
+
+  char line[128];
+  while ( fgets(line, sizeof(line), fp) ) {
+    int led;
+    float large, small;
+    if ( line[0] == '#' )
+      continue;
+    if ( sscanf(line, "%d %f %f", &led, &large, &small) == 3 && led >= 0 && led < SIM_CHANNELS ) {
+      channels[led].large = large;
+      channels[led].small = small;
+    }
+  }
+  fclose(fp);
+  return true;
+}
+
+// Turn the light in the box to <level> at <ms> of virtual time
+bool simulator::scheduleLight(uint32_t ms, int level) {
+  if ( nEvents >= SIM_EVENTS )
+    return false;
+  eventAt[nEvents]    = (uint64_t)ms * 1000;
+  eventLight[nEvents] = level;
+  nEvents++;
+  return true;
+}
+
+simAxis *simulator::getAxis(char name) {
+  for ( int i=0; i<SIM_AXES; i++ )
+    if ( axes[i].name == name )
+      return &axes[i];
+  return 0x0;
+}
+
+simAxis *simulator::findAxis(uint8_t shield, uint8_t port) {
+  for ( int i=0; i<SIM_AXES; i++ )
+    if ( axes[i].shield == shield && axes[i].port == port )
+      return &axes[i];
+  return 0x0;
+}
+
+/********************************* Clock ************************************/
+void simulator::advance(uint32_t us) {
+  now += us;
+
+  for ( int i=0; i<nEvents; i++ ) {
+    if ( now >= eventAt[i] ) {
+      light = eventLight[i];
+      eventAt[i]    = eventAt[nEvents-1];
+      eventLight[i] = eventLight[nEvents-1];
+      nEvents--;
+      i--;
+    }
+  }
+
+  if ( panicDue && now >= panicDue ) {
+    panicDue = 0;
+    raiseInterrupt(0);
+  }
+
+  // Hold the virtual clock to <speed> x real time
+  if ( speed > 0.0f ) {
+    uint64_t due = realStart + (uint64_t)(now / speed);
+    uint64_t real = realMicros();
+    if ( due > real ) {
+      struct timespec ts = { (time_t)((due - real) / 1000000), (long)((due - real) % 1000000) * 1000 };
+      nanosleep(&ts, 0x0);
+    }
+  }
+}
+
+void simulator::delayMicros(uint32_t us) {
+  advance(us);
+}
+
+/********************************* Pins ************************************/
+int simulator::digitalRead(uint8_t pin) {
+  for ( int i=0; i<SIM_AXES; i++ )
+    if ( axes[i].pin == pin )
+      return (axes[i].position <= 0) ? 1 : 0;
+  return 0;
+}
+
+// The latch going high moves the shifted bytes onto the LEDs
+void simulator::digitalWrite(uint8_t pin, uint8_t value) {
+  if ( pin != latchPin )
+    return;
+
+  if ( value == 0 ) {
+    nShifted = 0;
+    return;
+  }
+
+  if ( nShifted == 3 )
+    lit = shifted[2] | ((uint32_t)shifted[1] << 8) | ((uint32_t)(shifted[0] & 0x3) << 16);
+  nShifted = 0;
+}
+
+void simulator::shiftOut(uint8_t, uint8_t, uint8_t, uint8_t val) {
+  advance(SHIFT_BYTE);
+  if ( nShifted < 3 )
+    shifted[nShifted++] = val;
+}
+
+double simulator::gauss(void) {
+  // xorshift64* feeding Box-Muller, independent of the firmware's random()
+  double u[2];
+  for ( int i=0; i<2; i++ ) {
+    noiseState ^= noiseState >> 12;
+    noiseState ^= noiseState << 25;
+    noiseState ^= noiseState >> 27;
+    u[i] = ((noiseState * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0);
+  }
+  if ( u[0] < 1e-12 )
+    u[0] = 1e-12;
+  return sqrt(-2.0 * log(u[0])) * cos(2.0 * M_PI * u[1]);
+}
+
+int simulator::analogRead(uint8_t pin) {
+  advance(ADC_CONVERSION);
+
+  double value;
+  if ( pin == photoPin ) {
+    value = light + 0.2 * noise * gauss();
+  }
+  else if ( pin == largeDiodePin || pin == smallDiodePin ) {
+    value = dark;
+    for ( int i=0; i<SIM_CHANNELS; i++ )
+      if ( lit & (1UL << i) )
+        value += (pin == largeDiodePin) ? channels[i].large : channels[i].small;
+    value += noise * gauss();
+  }
+  else {
+    value = 512 + 100 * gauss();   // floating pin
+  }
+
+  if ( value < 0 )
+    value = 0;
+  if ( value > 1023 )
+    value = 1023;
+  return (int)value;
+}
+
+/****************************** Motor shields *******************************/
+void simulator::motorStep(uint8_t shield, uint8_t port, uint8_t dir, uint8_t style) {
+  advance(COIL_WRITES * PWM_WRITE_BYTES * i2cByte);
+
+  simAxis *axis = findAxis(shield, port);
+  if ( !axis )
+    return;
+
+  int32_t move = MICROSTEPS;
+  if ( style == MICROSTEP )
+    move = 1;
+  else if ( style == INTERLEAVE )
+    move = MICROSTEPS / 2;
+  if ( dir == BACKWARD )
+    move = -move;
+
+  axis->energized = true;
+  axis->coilChanges++;
+
+  // Stepped faster than the motor can follow, the rotor slips and the
+  // carriage stays where it is
+  bool slips = axis->stallUs && (now - axis->lastStep) * MICROSTEPS < (uint64_t)abs(move) * axis->stallUs;
+  axis->lastStep = now;
+  if ( slips ) {
+    axis->lost++;
+    return;
+  }
+
+  axis->position += move;
+
+  // Pushing on a hard stop just skips steps
+  if ( axis->position < axis->minStop ) {
+    axis->position = axis->minStop;
+    axis->lost++;
+  }
+  else if ( axis->position > axis->maxStop ) {
+    axis->position = axis->maxStop;
+    axis->lost++;
+  }
+}
+
+void simulator::motorRelease(uint8_t shield, uint8_t port) {
+  advance(4 * PWM_WRITE_BYTES * i2cByte);
+
+  simAxis *axis = findAxis(shield, port);
+  if ( axis )
+    axis->energized = false;
+}
+
+void simulator::i2cWrite(uint8_t address, const uint8_t *data, uint8_t len) {
+  advance((len + 1) * i2cByte);
+
+  // ALL_LED_OFF_H with the full-off bit drops every coil on the shield
+  if ( len == 2 && data[0] == 0xFD && (data[1] & 0x10) ) {
+    for ( int i=0; i<SIM_AXES; i++ )
+      if ( axes[i].shield == address )
+        axes[i].energized = false;
+
+    if ( panicAt && !releasedAt ) {
+      bool any = false;
+      for ( int i=0; i<SIM_AXES; i++ )
+        any |= axes[i].energized;
+      if ( !any )
+        releasedAt = now;
+    }
+  }
+}
+
+void simulator::raiseInterrupt(uint8_t n) {
+  if ( !panicAt )
+    panicAt = now;
+  hal::raiseInterrupt(n);
+}
+
+/******************************* Scripting ***********************************/
+// On top of the hal's:  !light <level>   !park <axis> <steps>   !stall <axis> <us>
+// and !panic <ms>, which presses the button <ms> into whatever runs next
+void simulator::directive(const char *line) {
+  if ( !strncmp(line, "panic", 5) && atol(line + 5) > 0 ) {
+    panicDue = now + 1000ULL * atol(line + 5);
+    return;
+  }
+  if ( !strncmp(line, "light", 5) ) {
+    light = atoi(line + 5);
+    return;
+  }
+  if ( !strncmp(line, "park", 4) ) {
+    char name;
+    float steps;
+    if ( sscanf(line + 4, " %c %f", &name, &steps) == 2 && getAxis(name) )
+      getAxis(name)->position = (int32_t)(steps * MICROSTEPS);
+    return;
+  }
+  if ( !strncmp(line, "stall", 5) ) {
+    char name;
+    unsigned us;
+    if ( sscanf(line + 5, " %c %u", &name, &us) == 2 && getAxis(name) )
+      getAxis(name)->stallUs = us;
+    return;
+  }
+  hal::directive(line);
+}
+
+void simulator::report(FILE *fp) {
+  fprintf(fp, "sim: %.3f s virtual, %.3f s real, %u bytes sent\n", now / 1e6,
+          (realMicros() - realStart) / 1e6, txBytes);
+  for ( int i=0; i<SIM_AXES; i++ )
+    fprintf(fp, "sim: %c at %.2f steps, %u coil changes, %u lost, %s\n", axes[i].name,
+            (double)axes[i].position / MICROSTEPS, axes[i].coilChanges, axes[i].lost,
+            axes[i].energized ? "energized" : "released");
+  if ( panicAt && releasedAt )
+    fprintf(fp, "sim: panic at %.3f ms, coils released %.3f ms later\n", panicAt / 1e3, (releasedAt - panicAt) / 1e3);
+  else if ( panicAt )
+    fprintf(fp, "sim: panic at %.3f ms, coils never released\n", panicAt / 1e3);
+}
@@ -0,0 +1,107 @@
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include <stdio.h>
+#include "hal.h"
+
+#define SIM_AXES     4
+#define SIM_CHANNELS 18
+#define SIM_EVENTS   16
+
+// One axis of the stand, positions are in microsteps (1/16 step) from
+// the point where the limit switch trips
+struct simAxis {
+  char     name;
+  uint8_t  shield, port, pin;
+  int32_t  position;
+  int32_t  minStop, maxStop;    // hard stops, the carriage goes no further
+  bool     energized;
+  uint32_t coilChanges;
+  uint32_t lost;                // coil changes spent pushing on a hard stop, or slipped
+  uint32_t stallUs;             // full steps closer together than this slip (0 never)
+  uint64_t lastStep;
+};
+
+// What the two photodiodes see when a channel's LED is lit, before noise
+struct simChannel {
+  float large, small;
+};
+
+/*
+ * A time-accelerated model of the QC stand. The four axes move with the
+ * coil changes the firmware makes through the motor shield library, trip
+ * their limit switches at position 0 and stall on hard stops either end.
+ * The 18 LEDs are decoded from the shift registers and feed the large
+ * and small diodes through per channel attenuation plus gaussian noise;
+ * photoPin sees the ambient light in the box. Time is virtual: every
+ * delay, ADC conversion, shift register load and I2C write is charged to
+ * the clock, which runs <speed> times faster than real time (0 = as fast
+ * as the host can go).
+ */
+class simulator : public hal {
+
+ public:
+  simulator                    ( void );
+
+  void     setSpeed            ( float s ) {speed = s;}
+  void     setNoise            ( float n ) {noise = n;}
+  void     setLight            ( int l )   {light = l;}
+  void     setI2CCost          ( uint32_t us ) {i2cByte = us;}
+  bool     scheduleLight       ( uint32_t, int );
+  bool     loadChannels        ( const char * );
+  void     seed                ( uint32_t );
+  void     report              ( FILE * );
+
+  uint32_t elapsed             ( void ) {return (uint32_t)now;}
+
+  // Virtual us from the last panic to every coil dropping, -1 if they
+  // haven't (or there was no panic)
+  int64_t  stopLatency         ( void ) {return (panicAt && releasedAt) ? (int64_t)(releasedAt - panicAt) : -1;}
+  void     clearPanic          ( void ) {panicAt = releasedAt = panicDue = 0;}
+  simAxis *getAxis             ( char );
+
+  // hal
+  void     delayMicros         ( uint32_t );
+  int      digitalRead         ( uint8_t );
+  void     digitalWrite        ( uint8_t, uint8_t );
+  int      analogRead          ( uint8_t );
+  void     shiftOut            ( uint8_t, uint8_t, uint8_t, uint8_t );
+  void     i2cWrite            ( uint8_t, const uint8_t *, uint8_t );
+  void     motorStep           ( uint8_t, uint8_t, uint8_t, uint8_t );
+  void     motorRelease        ( uint8_t, uint8_t );
+  void     raiseInterrupt      ( uint8_t );
+
+ protected:
+  void     directive           ( const char * );
+  void     advance             ( uint32_t );
+  double   gauss               ( void );
+  simAxis *findAxis            ( uint8_t, uint8_t );
+
+  simAxis    axes[SIM_AXES];
+  simChannel channels[SIM_CHANNELS];
+
+  float      speed;
+  float      noise;
+  int        light;
+  int        dark;
+  uint32_t   i2cByte;           // us per byte on the I2C bus
+  uint64_t   realStart;
+
+  // Shift register chain, loaded while the latch is low
+  uint8_t    shifted[3];
+  uint8_t    nShifted;
+  uint32_t   lit;               // bit mask of lit LEDs
+
+  // Scheduled changes to the light in the box
+  uint64_t   eventAt[SIM_EVENTS];
+  int        eventLight[SIM_EVENTS];
+  int        nEvents;
+
+  // Panic bookkeeping, panicDue is a '!panic <ms>' yet to go off
+  uint64_t   panicDue;
+  uint64_t   panicAt;
+  uint64_t   releasedAt;
+
+  uint64_t   noiseState;
+};
+#endif
@@ -0,0 +1,74 @@
+/*
+ * Latency histograms from a TRACE dump. Feed it the firmware's output
+ * (anything other than the t2/t3 lines is ignored) and it prints, for
+ * each event id, the time between consecutive events with that id:
+ *
+ *   id  count  min_us  median_us  p99_us  max_us  then a log2 histogram
+ *
+ *   oduqc_tracehist < session.log
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <vector>
+#include <algorithm>
+
+int main(int, char **) {
+
+  std::vector<unsigned long> intervals[128];
+  unsigned long lastSeen[128];
+  bool seen[128] = {false};
+  unsigned long now = 0;
+
+  char line[512];
+  while ( fgets(line, sizeof(line), stdin) ) {
+
+    // A new dump starts the clock again
+    if ( !strncmp(line, "t2 ", 3) ) {
+      unsigned count;
+      if ( sscanf(line + 3, "%u %lu", &count, &now) == 2 )
+        memset(seen, 0, sizeof(seen));
+      continue;
+    }
+    if ( strncmp(line, "t3 ", 3) )
+      continue;
+
+    for ( char *tok = strtok(line + 3, " \r\n"); tok; tok = strtok(NULL, " \r\n") ) {
+      unsigned char id = tok[0];
+      if ( id >= 128 || !isdigit((unsigned char)tok[1]) )
+        continue;
+
+      now += strtoul(tok + 1, NULL, 10);
+      if ( seen[id] )
+        intervals[id].push_back(now - lastSeen[id]);
+      lastSeen[id] = now;
+      seen[id] = true;
+    }
+  }
+
+  printf("id\tcount\tmin_us\tmedian_us\tp99_us\tmax_us\thistogram(log2 us)\n");
+  for ( int id=0; id<128; id++ ) {
+    std::vector<unsigned long> &v = intervals[id];
+    if ( v.empty() )
+      continue;
+
+    std::sort(v.begin(), v.end());
+    unsigned buckets[33] = {0};
+    for ( size_t i=0; i<v.size(); i++ ) {
+      int b = 0;
+      while ( b < 32 && (1UL << b) <= v[i] )
+        b++;
+      buckets[b]++;
+    }
+
+    printf("%c\t%zu\t%lu\t%lu\t%lu\t%lu\t", id, v.size(), v.front(), v[v.size() / 2],
+           v[(v.size() * 99) / 100], v.back());
+    for ( int b=0; b<33; b++ )
+      if ( buckets[b] )
+        printf(" <%lu:%u", 1UL << b, buckets[b]);
+    printf("\n");
+  }
+
+  return 0;
+}
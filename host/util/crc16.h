@@ -0,0 +1,13 @@
+#ifndef UTIL_CRC16_H
+#define UTIL_CRC16_H
+
+#include <stdint.h>
+
+// avr-libc's CRC-CCITT step, from the C equivalent in its documentation
+static inline uint16_t _crc_ccitt_update( uint16_t crc, uint8_t data ) {
+  data ^= crc & 0xFF;
+  data ^= data << 4;
+  return ((((uint16_t)data << 8) | (crc >> 8)) ^ (uint8_t)(data >> 4) ^ ((uint16_t)data << 3));
+}
+
+#endif
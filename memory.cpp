@@ -0,0 +1,55 @@
+#include "memory.h"
+#include "readSerial.h"
+#include "circuit.h"
+#include "motorBoss.h"
+#include "storage.h"
+#include "messages.h"
+
+#ifdef __AVR__
+#define STACK_PAINT 0xC5
+
+extern uint8_t __data_start, __data_end, __bss_start, __bss_end;
+extern uint8_t __heap_start, *__brkval;
+extern uint8_t __stack;
+
+// Paint everything from the end of .bss to the top of the stack before
+// anything runs, so the deepest the stack reaches shows as worn paint.
+// This runs in .init1, before r1 is cleared or the stack pointer set up,
+// so it has to be assembler
+void paintStack( void ) __attribute__ ((naked, used, section (".init1")));
+void paintStack( void ) {
+  __asm volatile ("    ldi r30,lo8(__bss_end)\n"
+                  "    ldi r31,hi8(__bss_end)\n"
+                  "    ldi r24,lo8(0xC5)\n"
+                  "    ldi r25,hi8(__stack)\n"
+                  "    rjmp 2f\n"
+                  "1:  st Z+,r24\n"
+                  "2:  cpi r30,lo8(__stack)\n"
+                  "    cpc r31,r25\n"
+                  "    brlo 1b\n"
+                  "    breq 1b\n" ::);
+}
+
+// Count up from the heap until the paint runs out
+uint stackPeak( void ) {
+  uint8_t *p = __brkval ? __brkval : &__heap_start;
+  while ( p <= &__stack && *p == STACK_PAINT )
+    p++;
+  return (uint)(&__stack - p) + 1;
+}
+#else
+uint stackPeak( void ) {return 0;}
+#endif
+
+void memoryReport( void ) {
+#ifdef __AVR__
+  uint8_t here;
+  uint8_t *heapEnd = __brkval ? __brkval : &__heap_start;
+  say(MSG_SRAM, (uint)(&__data_end - &__data_start), (uint)(&__bss_end - &__bss_start),
+      (uint)(heapEnd - &__heap_start), (uint)(&here - heapEnd),
+      (uint)(&__stack - &here), stackPeak());
+#endif
+
+  say(MSG_RESERVED, (uint)staticSlot<readSerial>::size(), (uint)staticSlot<circuit>::size(),
+      (uint)staticSlot<motorBoss>::size());
+}
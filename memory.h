@@ -0,0 +1,23 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/*
+ * Where the 2 kB of SRAM went. 'M' reports
+ *
+ *   20 SRAM data <n> bss <n> heap <n> free <n> stack <n> peak <n>
+ *   21 Reserved reader <n> circuit <n> boss <n>
+ *
+ * data and bss are the static allocation, heap what malloc has taken
+ * (nothing, since nothing allocates), free the gap between the heap and
+ * the stack right now, stack the current depth and peak the deepest the
+ * stack has been since reset, found from the paint laid down before
+ * main(). The 21 line is the storage reserved for the objects 'G' and
+ * setup() build. Only the 21 line means anything off the board.
+ */
+void memoryReport( void );
+uint stackPeak   ( void );
+
+#endif
@@ -0,0 +1,100 @@
+#include <stdarg.h>
+#include "messages.h"
+
+struct message {
+  char        key[4];
+  bool        bare;
+  const char *format;       // in flash
+};
+
+// The formats, then the table pointing at them, all in flash
+#define MSG(name, key, bare, format) static const char fmt_##name[] PROGMEM = format;
+MESSAGE_TABLE
+#undef MSG
+
+#define MSG(name, key, bare, format) { key, bare, fmt_##name },
+static const message table[MESSAGES] PROGMEM = {
+  MESSAGE_TABLE
+};
+#undef MSG
+
+static bool TERSE = false;
+
+bool setTerse( bool terse ) {
+  TERSE = terse;
+  return TERSE;
+}
+
+bool isTerse( void ) {return TERSE;}
+
+/*
+ * Send message <id> with its arguments. Verbose, the format is printed
+ * as is; terse, only the arguments go, each after a space.
+ */
+void say( int id, ... ) {
+  if ( id < 0 || id >= MESSAGES )
+    return;
+
+  message m;
+  memcpy_P(&m, &table[id], sizeof(m));
+
+  if ( TERSE )
+    Serial.print(m.key);
+  else if ( !m.bare ) {
+    Serial.write(m.key[0]);
+    Serial.write(m.key[1]);
+    Serial.write(' ');
+  }
+
+  va_list ap;
+  va_start(ap, id);
+
+  const char *p = m.format;
+  char c;
+  while ( (c = pgm_read_byte(p++)) ) {
+    if ( c != '%' ) {
+      if ( !TERSE )
+        Serial.write(c);
+      continue;
+    }
+
+    bool isLong = false;
+    if ( (c = pgm_read_byte(p++)) == 'l' ) {
+      isLong = true;
+      c = pgm_read_byte(p++);
+    }
+
+    if ( TERSE )
+      Serial.write(' ');
+
+    switch ( c ) {
+    case 'i':
+      if ( isLong ) Serial.print(va_arg(ap, long));
+      else          Serial.print(va_arg(ap, int));
+      break;
+    case 'u':
+      if ( isLong ) Serial.print(va_arg(ap, unsigned long));
+      else          Serial.print(va_arg(ap, unsigned int));
+      break;
+    case 'x':
+      if ( isLong ) Serial.print(va_arg(ap, unsigned long), HEX);
+      else          Serial.print(va_arg(ap, unsigned int), HEX);
+      break;
+    case 'c':
+      Serial.write((char)va_arg(ap, int));
+      break;
+    case 's':
+      Serial.print(va_arg(ap, const char *));
+      break;
+    case 'f':
+      Serial.print(va_arg(ap, double));
+      break;
+    default:
+      p--;      // not ours, leave it be
+      break;
+    }
+  }
+
+  va_end(ap);
+  Serial.println();
+}
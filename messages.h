@@ -0,0 +1,112 @@
+#ifndef MESSAGES_H
+#define MESSAGES_H
+
+/*
+ * Every line the firmware sends, in one table. Each message has a key
+ * (its two character code, plus a digit where several messages share a
+ * code), a bare flag for the old debugging lines that go out without
+ * their code, and a format:
+ *
+ *   %i %u %li %lu %x   int, unsigned, long, unsigned long, hex
+ *   %c %s %f           char, RAM string, float (2 places)
+ *
+ * In the normal (verbose) mode say() sends exactly the line the firmware
+ * always has, "a1 GORT is awake!". In terse mode ('v') it sends the key
+ * and the arguments alone, "a1", "c2 1234 385 12 38 95 755 71 27 42",
+ * and oduqc_decode on the host turns them back into the long form. A
+ * line's first two characters are its code either way.
+ *
+ *     name            key    bare  format
+ */
+#define MESSAGE_TABLE \
+  MSG(READY,           "00",  0, "Ready")                                  \
+  MSG(IDENT,           "01",  0, "ODUQC")                                  \
+  MSG(DONE,            "04",  0, "done")                                   \
+  MSG(SUBTRACT,        "05",  0, "Background subtraction %s")              \
+  MSG(NUM_LEDS,        "06",  0, "Number of LEDs = %u")                    \
+  MSG(SAMPLES,         "07",  0, "Sample size = %u")                       \
+  MSG(PARKED,          "08",  0, "Motors parked")                          \
+  MSG(MOVED,           "09",  0, "Move Complete")                          \
+  MSG(ODU_TYPE,        "10",  0, "ODU type %s")                            \
+  MSG(DELAY_SET,       "11",  0, "Delay set to %u")                        \
+  MSG(CONNECTOR,       "12",  0, "ODU connector %u")                       \
+  MSG(ODU_DONE,        "13",  0, "ODU test done")                          \
+  MSG(ODU_ABORTED,     "14",  0, "ODU test aborted %u")                    \
+  MSG(BAUD,            "15",  0, "Baud %lu")                               \
+  MSG(THROUGHPUT,      "16",  0, "Throughput %u bytes %lu us")             \
+  MSG(TELEMETRY,       "17",  0, "Telemetry every %u ms")                  \
+  MSG(TELEMETRY_OFF,   "171", 0, "Telemetry off")                          \
+  MSG(LATENCY,         "18",  0, "Stop latency %lu us")                    \
+  MSG(BENCH_PHASE,     "19",  0, "%s %lu %lu %lu")                         \
+  MSG(BENCH_CLEARED,   "191", 0, "Bench cleared")                          \
+  MSG(SRAM,            "20",  0, "SRAM data %u bss %u heap %u free %u stack %u peak %u") \
+  MSG(RESERVED,        "21",  0, "Reserved reader %u circuit %u boss %u")  \
+  MSG(TERSE,           "22",  0, "Terse %s")                               \
+  MSG(CAL_RECORD,      "23",  0, "Calibration %lu slot %i channels %u noise %i/%i") \
+  MSG(MAP_ENTRY,       "24",  0, "Map %u connector %u x %i y %i z %i r %i high %u") \
+  MSG(MAP,             "25",  0, "Map %u crc %x slot %i sequence %lu")     \
+  MSG(MAP_STAGED,      "26",  0, "Map %u staged %u")                       \
+  MSG(MAP_SAVED,       "27",  0, "Map %u saved slot %i sequence %lu")      \
+  MSG(SLIDE,           "28",  0, "Slide %s")                               \
+  MSG(PREFETCH,        "29",  0, "Dark baseline on the move %s")           \
+  MSG(DRIFT,           "2a",  0, "%c was %f steps out at its switch, corrected") \
+  MSG(DRIFT_COUNT,     "2b",  0, "Corrected X %u last %i Y %u last %i Z %u last %i R %u last %i") \
+  MSG(SPEEDS,          "2c",  0, "Speeds X %u Y %u Z %u R %u")             \
+  MSG(TUNE_TRY,        "2d",  0, "%c at %u rpm %s")                        \
+  MSG(TUNED,           "2e",  0, "%c set to %u rpm slot %i")               \
+  MSG(AWAKE,           "a1",  0, "GORT is awake!")                         \
+  MSG(ASLEEP,          "a2",  0, "Klautu barada nictu")                    \
+  MSG(LED_START,       "c1",  0, "%i LED %i")                              \
+  MSG(LED_DATA,        "c2",  0, "%i PD %i.%i(%i.%i)/%i.%i(%i.%i)")        \
+  MSG(CALIBRATING,     "c3",  0, "Calibrating ... ")                       \
+  MSG(CALIBRATED,      "c4",  0, " Calibrating ... Done.")                 \
+  MSG(NO_PORT,         "fa",  0, "No such motor on port %u")               \
+  MSG(BAD_BAUD,        "fb",  0, "Unsupported baud rate")                  \
+  MSG(BAUD_FALLBACK,   "fc",  0, "Baud fallback %lu")                      \
+  MSG(PANIC,           "fd",  0, "PANICING!")                              \
+  MSG(LIGHT_LEAK,      "fe",  0, "Fatal Error: Too much light in the box") \
+  MSG(LED_ABORTED,     "fe1", 0, "LED %i aborted")                         \
+  MSG(LEAK_CLEARED,    "ff",  0, "Fatal Error: light leak cleared")        \
+  MSG(CRASH_CLEARED,   "ff1", 0, "Crash Stop cleared")                     \
+  MSG(FATAL_CLEARED,   "ff2", 0, "Fatal Error cleared")                    \
+  MSG(UNCALIBRATED,    "ff3", 0, "Please run the calibration for the QCBot") \
+  MSG(NO_SHIELD,       "ff4", 0, "No such shield on 0x%x")                 \
+  MSG(MOTOR_FAILED,    "ff5", 0, "%c motor failed")                        \
+  MSG(CAL_CORRUPT,     "ff6", 0, "Calibration slot %u corrupt")            \
+  MSG(CAL_LEGACY,      "ff7", 0, "Old calibration layout, please recalibrate") \
+  MSG(CAL_NOT_SAVED,   "ff8", 0, "Calibration not saved")                  \
+  MSG(MAP_REJECTED,    "ff9", 0, "Map %u rejected")                        \
+  MSG(DARK_HIGH,       "ffa", 0, "Dark baseline high L %i S %i")           \
+  MSG(TUNE_FAILED,     "ffb", 0, "%c loses steps at %u rpm")               \
+  MSG(SLEEPING,        "d0",  1, "GORT is sleeping")                       \
+  MSG(ECHO,            "d1",  1, "Echo %s")                                \
+  MSG(ON_LIMIT,        "d2",  1, "On the limit switch")                    \
+  MSG(OFF_LIMIT,       "d3",  1, "Off the limit switch")                   \
+  MSG(USER_STOP,       "d4",  1, "User requested stop")                    \
+  MSG(SOMETHING_BAD,   "d5",  1, "Something bad is happening")             \
+  MSG(NO_AXIS,         "d6",  1, "No such motor on %c")                    \
+  MSG(NO_MOTION,       "d7",  1, "No motion requested")                    \
+  MSG(STEPPED,         "d8",  1, "%c took %i steps  to position %f")       \
+  MSG(MICROSTEPPED,    "d9",  1, "%c took %i steps , and %i microsteps to position %f") \
+  MSG(NO_NORM,         "da",  1, "Unknown normalization!")                 \
+  MSG(NORM,            "db",  1, "normalization[%i] = %i.%i")              \
+  MSG(HEAD_AT,         "dc",  1, "Connector head at (%i.%i, %i.%i, %i.%i, %i.%i)") \
+  MSG(NO_MOTOR,        "dd",  1, "No motor defined!")
+
+#define MSG(name, key, bare, format) MSG_##name,
+enum messageId {
+  MESSAGE_TABLE
+  MESSAGES
+};
+#undef MSG
+
+#ifndef MESSAGES_TABLE_ONLY
+#include <Arduino.h>
+#include "config.h"
+
+void say       ( int, ... );
+bool setTerse  ( bool );
+bool isTerse   ( void );
+#endif
+
+#endif
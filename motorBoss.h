@@ -4,64 +4,88 @@
 #include "config.h"
 #include "motorShield.h"
 #include "axisMotor.h"
+#include "bench.h"
+#include "storage.h"
+#include "messages.h"
+#include "eepromStore.h"
+#include "connectorMap.h"
+#include "circuit.h"
+
+#define NOWHERE   0xFF            // not at a connector (or home) that we know of
+
+// Sliding, X backs off from the ODU face to here (and no further if it
+// doesn't have to turn), and anywhere behind it can move alongside Y
+#define clearLine (x_steps_to_odu - pinClearSteps)
 
 class motorBoss {
  public:
   motorBoss(void) {
 
+    for ( uint8_t i=0; i<NUM_AXES; i++ )
+      motors[i] = 0x0;
+
     // Create the motor shield class...
-    shield1 = new motorShield();
+    shield1 = shield1Slot.make();
     if ( !shield1 ) {
-      Serial.println(F("ff No such shield on 0x60"));
+      say(MSG_NO_SHIELD, 0x60);
       FATAL_ERROR = true;
       return;
     }
 
     // ...for both shields
-    shield2 = new motorShield(0x61);
+    shield2 = shield2Slot.make(0x61);
     if ( !shield2 ) {
-      Serial.println(F("ff No such shield on 0x61"));
+      say(MSG_NO_SHIELD, 0x61);
       FATAL_ERROR = true;
       return;
     }
 
     // Add the 28BYJ-48 motors for the X and R axes, these are 2048 steps/revolution
     if ( shield2 ) {
-      xmotor = new axisMotor(shield2, 'X', XInputPin, XLimit, xRPM, x_steps_per_revolution, xPort);
+      xmotor = xSlot.make(shield2);
       if ( !xmotor ) {
-        Serial.println(F("ff X motor failed"));
+        say(MSG_MOTOR_FAILED, 'X');
         FATAL_ERROR = true;
         return;
       }
 
-      rmotor = new axisMotor(shield2, 'R', RInputPin, RLimit, rRPM, r_steps_per_revolution, rPort);
+      rmotor = rSlot.make(shield2);
       if ( !rmotor ) {
-        Serial.println(F("ff R motor failed"));
+        say(MSG_MOTOR_FAILED, 'R');
         FATAL_ERROR = true;
         return;
       }
     }
 
     // Add the NEMA-17 motors for the Y & Z axes, these motors are 200 steps/revolution
-    // Motor instansiator (shield, axis, limit switch pin, max steps, rpm, steps/rev, shield port)
+    // Each axis' pin, limit, speed and port come from its traits in axisTraits.h
     if ( shield1 ) {
-      zmotor = new axisMotor(shield1, 'Z', ZInputPin, ZLimit, zRPM, z_steps_per_revolution, zPort);
+      zmotor = zSlot.make(shield1);
       if ( !zmotor ) {
-        Serial.println(F("ff Z motor failed"));
+        say(MSG_MOTOR_FAILED, 'Z');
         FATAL_ERROR = true;
         return;
       }
 
-      ymotor = new axisMotor(shield1, 'Y', YInputPin, YLimit, yRPM, y_steps_per_revolution, yPort);
+      ymotor = ySlot.make(shield1);
       if ( !ymotor ) {
-         Serial.println(F("ff Y motor failed"));
+        say(MSG_MOTOR_FAILED, 'Y');
         FATAL_ERROR = true;
         return;
       }
     }
 
+    motors[xAxis::index] = xmotor;
+    motors[yAxis::index] = ymotor;
+    motors[zAxis::index] = zmotor;
+    motors[rAxis::index] = rmotor;
+
     pluggedIn = false;
+    slide = false;
+    at = NOWHERE;
     type = 1;
+    loadMap();
+    loadSpeeds();
 
     resetHome();
 
@@ -69,23 +93,21 @@ class motorBoss {
   }
   ~motorBoss(void) {
     home();
+
+    // The motors hold pointers into their shields, so they go first
+    xSlot.destroy();
+    ySlot.destroy();
+    zSlot.destroy();
+    rSlot.destroy();
+    shield1Slot.destroy();
+    shield2Slot.destroy();
     return;
   }
 
+  // Case insensitive, and a table lookup rather than a chain of compares
   axisMotor *getMotorPtr( char axis ) {
-   // Make the axis label case insensitive
-   if ( axis > 90 )
-      axis -= 32;
-    if ( axis == 'Y' )
-      return ymotor;
-    else if ( axis == 'X' )
-      return xmotor;
-    else if ( axis == 'Z' && zmotor )
-      return zmotor;
-    else if ( axis == 'R' && rmotor )
-      return rmotor;
-    else 
-      return 0x0;
+    int8_t i = axisIndex(axis);
+    return (i < 0) ? 0x0 : motors[i];
   }
 
  // Find the home position 
@@ -98,109 +120,145 @@ class motorBoss {
     // Send each motor backward until it hits the limit switch
     // And reset the position & home switch in axisMotor appropriately
     if ( xmotor ) {
-      xmotor->stepMotor( XLimit+1, BACKWARD);
+      xmotor->stepMotor( -(XLimit+1) );
       xmotor->setHome(true);
     }
     if ( rmotor ) {
-      rmotor->stepMotor( RLimit+1, BACKWARD);
+      rmotor->stepMotor( -(RLimit+1) );
       rmotor->setHome(true);
     }
     if ( zmotor ) {
-      zmotor->stepMotor( ZLimit+1, BACKWARD);
+      zmotor->stepMotor( -(ZLimit+1) );
       zmotor->setHome(true);
     }
     if ( ymotor ) {
-      ymotor->stepMotor( YLimit+1, BACKWARD);
+      ymotor->stepMotor( -(YLimit+1) );
       ymotor->setHome(true);
     }
+    at = 0;
 
     return;
   }
 
-  // Relative move to the ODU connector at the 
-  // position defined in the y_steps_to_connector array
+  // Move to <connector> (19 is the calibration position) of this
+  // type's map. The dark baseline ('o') starts again and only takes in
+  // this move's steps
   void moveTo( uint connector ) {
+    if ( controller )
+      controller->darkMove(true);
+    goTo(connector);
+    if ( controller )
+      controller->darkMove(false);
+    return;
+  }
 
-    // Make sure we're not dragging an ODU with us
-    if ( pluggedIn )
-      unPlug();
+  // moveTo() without the dark baseline
+  void goTo( uint connector ) {
+
+    // Make sure we're not dragging an ODU with us. Sliding, that's only
+    // as far as the pins, and if the next connector's at the same X, Z
+    // and R it can stay there
+    bool slid = false;
+    if ( pluggedIn ) {
+      if ( slide ) {
+        slid = at >= 1 && at <= MAP_ENTRIES && connector >= 1 && connector <= MAP_ENTRIES &&
+               sameApproach(map.pos[at-1], map.pos[connector-1]);
+        pullBack();
+      }
+      else
+        unPlug();
+    }
     
     if ( connector == 0 ) {
       home();
       return;
     }
+    if ( connector > MAP_ENTRIES )
+      return;
 
-    // Figure out where we are, and where we're supposed to be based on 
-    // which type of ODU this is (2 & 4 are backwards from 1 & 3) and go
-    float distanceY = y_steps_to_connector[type-1][connector] - ymotor->getPosition();
-
-    // And move x into something like proper position
-    float distanceX;
-    if ( connector < 19 )
-      distanceX = x_steps_to_odu - plugSteps - xmotor->getPosition();
-    else 
-      distanceX = calibSteps - plugSteps - xmotor->getPosition();
-
-    float distanceR = 0.0f;
-    float distanceZ = 0.0f;
-
-    if ( rmotor && zmotor ) {
-      // Make sure the connector is in the proper orientation
-      if ( connector <= 16 ) {
-        distanceR = r_steps_to_90 - rmotor->getPosition();
-        distanceZ = z_steps_to_low_connectors - zmotor->getPosition();
-      }
-      else if ( connector == 17 ) {
-        if ( type % 2 ) {                                                 // Odd Types... 
-          distanceR = r_steps_to_180 - rmotor->getPosition();             // Rotate to 180 degrees
-          distanceZ = z_steps_to_high_connectors +z_offset_from_rotation - zmotor->getPosition();
-        }                                                                 // And move up to the connector
-        else {                                                            // Even Types
-          distanceR = r_steps_to_0 - rmotor->getPosition();               // Stay at 0 degrees
-          distanceZ = z_steps_to_high_connectors - zmotor->getPosition(); // Move up to the connector
-        }
+    // The legs in the order that won't hit anything, each from wherever
+    // its motor really is
+    movePlan plan;
+    planMove(map, connector, &plan);
+    uint8_t first = 0;
+
+    // Its first two legs are Y then X, and sliding they go together if X
+    // stays behind the pins the whole way
+    if ( slide && xmotor && ymotor ) {
+      float toX = plan.leg[1].target;
+      // (if they don't both get there, the legs below finish the job)
+      if ( slid || (toX <= clearLine && xmotor->getPosition() <= clearLine) ) {
+        if ( alongside(plan.leg[0].target - ymotor->getPosition(), slid ? 0.0f : toX - xmotor->getPosition()) )
+          first = 2;
       }
-      else if ( connector == 18 ) {
-        if ( type % 2 ) {                                                 // Odd Types... 
-          distanceR = r_steps_to_0 - rmotor->getPosition();               // Return to 0 degrees
-          distanceZ = z_steps_to_high_connectors - zmotor->getPosition(); // Move up to the connector
-        }
-        else {                                                            // Even Types
-          distanceR = r_steps_to_180 - rmotor->getPosition();             // Return to 0 degrees
-          distanceZ = z_steps_to_high_connectors + z_offset_from_rotation - zmotor->getPosition();
-        }                                                                 // And move to the connector up, up, and up
-      }
-      else if ( connector == 19 ) {                                       // Position for calibrating the system
-        distanceR = r_steps_to_0 - rmotor->getPosition();
-        distanceZ = z_steps_to_low_connectors - zmotor->getPosition();
-      }
-
-    } // End if ( rmotor && zmotor )
-
-    // Move to the connector, but do it in the proper order so we don't hit anything or bang into something
-    if ( distanceY )
-      ymotor->stepMotor(fabs(distanceY), (distanceY>0) ? FORWARD : BACKWARD);
-      
-    if ( (connector == 17 && type % 2) || (connector == 18 && !(type % 2)) ) { // If we're going high & turning over....
-      if ( distanceX )
-        xmotor->stepMotor(fabs(distanceX), (distanceX>0) ? FORWARD : BACKWARD);
-      if ( distanceZ )
-        zmotor->stepMotor(fabs(distanceZ), (distanceZ>0) ? FORWARD : BACKWARD);
-      if ( distanceR )
-        rmotor->stepMotor(fabs(distanceR), (distanceR>0) ? FORWARD : BACKWARD);
     }
-    else {                                                                     // If we're not going high or not turning over
-      if ( distanceX )
-        xmotor->stepMotor(fabs(distanceX), (distanceX>0) ? FORWARD : BACKWARD);
-      if ( distanceR )
-        rmotor->stepMotor(fabs(distanceR), (distanceR>0) ? FORWARD : BACKWARD);
-      if ( distanceZ )
-        zmotor->stepMotor(fabs(distanceZ), (distanceZ>0) ? FORWARD : BACKWARD);
+
+    for ( uint8_t i=first; i<PLAN_LEGS; i++ ) {
+      axisMotor *motor = motors[plan.leg[i].axis];
+      if ( !motor )
+        continue;
+      float distance = plan.leg[i].target - motor->getPosition();
+      if ( distance )
+        motor->stepMotor(distance);
     }
+    at = (CRASH_STOP || FATAL_ERROR) ? NOWHERE : connector;
     
     return;
   }
 
+  // Y and X at once, each stepping at its own pace. A forward Y goes
+  // past by the overshoot with X and comes back on its own, so it still
+  // finishes from the same side as stepMotor() does. False if either
+  // had to stop short
+  bool alongside( float dy, float dx ) {
+
+    uint dirY = (dy > 0) ? FORWARD : BACKWARD;
+    uint dirX = (dx > 0) ? FORWARD : BACKWARD;
+    long stepsY = fabs(dy), stepsX = fabs(dx);
+    float restY = dy - ((dy > 0) ? stepsY : -stepsY);
+    float restX = dx - ((dx > 0) ? stepsX : -stepsX);
+    if ( dy > 0 && yAxis::overshoots ) {
+      stepsY += overshoot;
+      restY  -= overshoot;
+    }
+
+    uint32_t everyY = ymotor->stepTime(), everyX = xmotor->stepTime();
+    uint32_t start = micros(), dueY = 0, dueX = 0;
+    bool going = true;
+    while ( going && (stepsY || stepsX) ) {
+
+      // Whichever's due next, once it is
+      bool yNext = stepsY && (!stepsX || dueY <= dueX);
+      uint32_t due = yNext ? dueY : dueX, now = micros() - start;
+      if ( due > now )
+        delayMicroseconds(due - now);
+
+      if ( yNext ) {
+        going = ymotor->stepOnce(dirY);
+        stepsY--;
+        dueY += everyY;
+      }
+      else {
+        going = xmotor->stepOnce(dirX);
+        stepsX--;
+        dueX += everyX;
+      }
+    }
+    if ( !going )
+      return false;
+
+    if ( restY )
+      ymotor->stepMotor(restY);
+    if ( restX )
+      xmotor->stepMotor(restX);
+    return true;
+  }
+
+  // Would the head go straight along Y from <a> to <b>?
+  static bool sameApproach( const connectorPos &a, const connectorPos &b ) {
+    return a.x == b.x && a.z == b.z && a.r == b.r;
+  }
+
   // Move back until we hit the stop switch at the 0 position
   // By default, send both motors home
   void home(char axis='\0') {
@@ -214,6 +272,7 @@ class motorBoss {
     if (pluggedIn )
       unPlug();
 
+    at = axis ? NOWHERE : 0;
     if ( !axis ) {
       if ( zmotor && !zmotor->getHome() )
         zmotor->home();
@@ -248,13 +307,16 @@ class motorBoss {
     if ( pluggedIn )
       return;
 
+    BENCH_START(benchStart);
     if ( !calib )
-      xmotor->stepMotor(x_steps_to_odu-xmotor->getPosition(), FORWARD);
+      xmotor->stepMotor(x_steps_to_odu-xmotor->getPosition());
     else
-      xmotor->stepMotor(calibSteps-xmotor->getPosition(), FORWARD);
+      xmotor->stepMotor(calibSteps-xmotor->getPosition());
       
     delay(50);
     pluggedIn = true;
+
+    BENCH_STOP(BENCH_PLUGIN, benchStart);
     return;
   }
 
@@ -262,26 +324,74 @@ class motorBoss {
     if ( !xmotor )
       return false;
 
+    BENCH_START(benchStart);
     float pos = (x_steps_to_odu - plugSteps) - xmotor->getPosition();
     if ( pos < 0 ) {
-      xmotor->stepMotor(fabs(pos), BACKWARD);
+      xmotor->stepMotor(pos);
       delay(50);
     }  
     pluggedIn = false;
 
+    BENCH_STOP(BENCH_UNPLUG, benchStart);
+
+    return;
+  }
+
+  // Unplug only as far as the pins need
+  void pullBack(void) {
+    if ( !xmotor )
+      return;
+
+    BENCH_START(benchStart);
+    float pos = clearLine - xmotor->getPosition();
+    if ( pos < 0 ) {
+      xmotor->stepMotor(pos);
+      delay(50);
+    }
+    pluggedIn = false;
+
+    BENCH_STOP(BENCH_UNPLUG, benchStart);
     return;
   }
 
+  bool setSlide(bool on) {
+    slide = on;
+    return slide;
+  }
+
+  bool getSlide(void) {
+    return slide;
+  }
+
   uint setType(int whichType) {
     
     if (whichType == 1 || whichType == 3 )
       this->type = 1;
     else
       this->type = 2;
-      
+
+    loadMap();
     return this->type;
   }
 
+  uint getType(void) {
+    return type;
+  }
+
+  // Where <type>'s maps live in the EEPROM (odd first, then even)
+  static recordArea mapArea( uint8_t type ) {
+    recordArea area = { (uint16_t)(MAP_BASE + (type - 1) * MAP_SLOTS * MAP_SLOT), MAP_SLOTS, MAP_SLOT,
+                        MAP_KIND, MAP_VERSION };
+    return area;
+  }
+
+  // Cache this type's map from the EEPROM, or the built in one if there's none
+  void loadMap(void) {
+    if ( recordLoad(mapArea(type), &map, sizeof(map)) < 0 )
+      builtInMap(type, &map);
+    return;
+  }
+
   void unlockMotors(void) {
     release('X');
     release('Y');
@@ -309,45 +419,76 @@ class motorBoss {
     // Do the rotation
     float steps = steps_per_degree * angle;
     rmotor->stepMotor(steps);
+    at = NOWHERE;
 
     return;
   }
 
   // Spit out where the motors think they are
   void position(void) {
-    int a = 0, b = 0;
-    char pos[10];
-    Serial.print(F("Connector head at ("));
-
-    a = (int)xmotor->getPosition();
-    b = 100*(xmotor->getPosition() - a);
-    sprintf(pos, "%i.%i", a, b);
-    Serial.print(pos);
-    Serial.print(F(", "));
-
-    a = (int)ymotor->getPosition();
-    b = 100*(ymotor->getPosition() - a);
-    sprintf(pos, "%i.%i", a, b);
-    Serial.print(pos);
-    Serial.print(F(", "));
-  
-    a = (int)zmotor->getPosition();
-    b = 100*(zmotor->getPosition() - a);
-    sprintf(pos, "%i.%i", a, b);
-    Serial.print(pos);
-    Serial.print(F(", "));
-
-    //a = degrees_per_step * (int)rmotor->getPosition();
-    //b = degrees_per_step * 100*(rmotor->getPosition() - a);
-    
-    a = (int)rmotor->getPosition();
-    b = 100*(rmotor->getPosition() - a);
-    sprintf(pos, "%i.%i", a, b);
-    Serial.print(pos);
-    //Serial.print((char)0xC2);
-    //Serial.print((char)0xB0);
-    Serial.println(F(")"));
+    float x = xmotor->getPosition(), y = ymotor->getPosition();
+    float z = zmotor->getPosition(), r = rmotor->getPosition();
 
+    say(MSG_HEAD_AT, (int)x, (int)(100*(x - (int)x)), (int)y, (int)(100*(y - (int)y)),
+                     (int)z, (int)(100*(z - (int)z)), (int)r, (int)(100*(r - (int)r)));
+    return;
+  }
+
+  // How many times each axis' count has been put right at its switch,
+  // and how far out it was the last time
+  void drift(void) {
+    say(MSG_DRIFT_COUNT, xmotor->getCorrections(), (int)xmotor->getDrift(),
+                         ymotor->getCorrections(), (int)ymotor->getDrift(),
+                         zmotor->getCorrections(), (int)zmotor->getDrift(),
+                         rmotor->getCorrections(), (int)rmotor->getDrift());
+    return;
+  }
+
+  // The speed config.h gives axis <i> (by axisIndex()), where tuning starts
+  static uint defaultSpeed( int8_t i ) {
+    static const uint rpm[NUM_AXES] = { xAxis::rpm, yAxis::rpm, zAxis::rpm, rAxis::rpm };
+    return rpm[i];
+  }
+
+  // Where the tuned speeds live in the EEPROM ('u')
+  static recordArea speedArea(void) {
+    recordArea area = { TUNE_BASE, TUNE_SLOTS, TUNE_SLOT, TUNE_KIND, TUNE_VERSION };
+    return area;
+  }
+
+  // Tuned speeds from the EEPROM, config.h's for any axis without a sane one
+  void loadSpeeds(void) {
+    uint16_t rpm[NUM_AXES];
+    if ( recordLoad(speedArea(), rpm, sizeof(rpm)) < 0 )
+      memset(rpm, 0, sizeof(rpm));
+
+    for ( int8_t i=0; i<NUM_AXES; i++ ) {
+      if ( !motors[i] )
+        continue;
+      uint base = defaultSpeed(i);
+      motors[i]->setSpeed( (rpm[i] && rpm[i] <= TUNE_CEILING * base) ? rpm[i] : base );
+    }
+    return;
+  }
+
+  // Keep the speeds the axes have now; the slot, or -1
+  int8_t saveSpeeds(void) {
+    uint16_t rpm[NUM_AXES];
+    for ( int8_t i=0; i<NUM_AXES; i++ )
+      rpm[i] = motors[i] ? motors[i]->getSpeed() : 0;
+    return recordSave(speedArea(), rpm, sizeof(rpm));
+  }
+
+  // Back to config.h's speeds, kept as if they'd been tuned
+  int8_t resetSpeeds(void) {
+    for ( int8_t i=0; i<NUM_AXES; i++ )
+      if ( motors[i] )
+        motors[i]->setSpeed(defaultSpeed(i));
+    return saveSpeeds();
+  }
+
+  void speeds(void) {
+    say(MSG_SPEEDS, xmotor->getSpeed(), ymotor->getSpeed(), zmotor->getSpeed(), rmotor->getSpeed());
     return;
   }
 
@@ -360,31 +501,44 @@ class motorBoss {
 
     axisMotor *motor = (getMotorPtr(axis));
     if ( !motor ) {
-      Serial.println(F("No motor defined!"));
+      say(MSG_NO_MOTOR);
       return;
     }
 
     // Move the requested motor, full checking and pause for stop requests
     motor->stepMotor( steps );
+    at = NOWHERE;
 
     return;
   }
 
  private:
 
-  axisMotor   *xmotor;            // motor on the plug in/plug out axis
-  axisMotor   *ymotor;            // motor on the long axis
-  axisMotor   *zmotor;            // Up & down motor
-  axisMotor   *rmotor;            // Rotation axis
+  stepperAxis<xAxis> *xmotor;     // motor on the plug in/plug out axis
+  stepperAxis<yAxis> *ymotor;     // motor on the long axis
+  stepperAxis<zAxis> *zmotor;     // Up & down motor
+  stepperAxis<rAxis> *rmotor;     // Rotation axis
+
+  axisMotor   *motors[NUM_AXES];  // the same four, by axisIndex()
   
   motorShield *shield1;           // circuit board controlling the motors
   motorShield *shield2;           // circuit board controlling the motors
 
+  // Where they live, inside the boss rather than on the heap
+  staticSlot< stepperAxis<xAxis> > xSlot;
+  staticSlot< stepperAxis<yAxis> > ySlot;
+  staticSlot< stepperAxis<zAxis> > zSlot;
+  staticSlot< stepperAxis<rAxis> > rSlot;
+  staticSlot<motorShield> shield1Slot, shield2Slot;
+
   bool pluggedIn;
+  bool slide;                     // between connectors, back off only as far as the pins ('f')
+  uint8_t at;                     // the connector we last moved to, 0 home, or NOWHERE
   uint type;
+  connectorMap map;               // this type's, so moveTo() never waits on the EEPROM
   
 };
 
-static motorBoss *boss;
+extern motorBoss *boss;
 
 #endif
@@ -2,30 +2,64 @@
 #define MOTORSHIELD_H
 
 #include <Adafruit_MotorShield.h>
+#include <Wire.h>
 #include "config.h"
+#include "messages.h"
+
+// PCA9685 register that turns every PWM channel on the chip fully off
+#define ALL_LED_OFF_H 0xFD
+#define MAX_SHIELDS   2
 
 class motorShield : public Adafruit_MotorShield {
  public:
   motorShield(int address=0x60) {
     start(address);
   }
-  ~motorShield(void){begun = false;}
+  ~motorShield(void){
+    begun = false;
+    for ( int i=0; i<MAX_SHIELDS; i++ )
+      if ( registry()[i] == this )
+        registry()[i] = 0x0;
+  }
 
   void start(int address=0x60) {
     // Create the motor shield object with the default I2C address
     AFMS = Adafruit_MotorShield(address); 
     AFMS.begin();
+    this->address = address;
     begun = true;
+
+    // Remember the shield so a panic can find it
+    for ( int i=0; i<MAX_SHIELDS; i++ ) {
+      if ( !registry()[i] || registry()[i] == this ) {
+        registry()[i] = this;
+        break;
+      }
+    }
+  }
+
+  // Kill the coil current on every channel of this shield in one I2C write
+  void cutPower(void) {
+    if ( !begun )
+      return;
+    Wire.beginTransmission(address);
+    Wire.write(ALL_LED_OFF_H);
+    Wire.write(0x10);
+    Wire.endTransmission();
+  }
+
+  // ...and on every shield we know about
+  static void cutAll(void) {
+    for ( int i=0; i<MAX_SHIELDS; i++ )
+      if ( registry()[i] )
+        registry()[i]->cutPower();
   }
 
   Adafruit_StepperMotor *getStepperMotor(uint port, uint steps=200 ) {
     // Connect a stepper motor with steps/revolution to port
     Adafruit_StepperMotor *m = AFMS.getStepper(steps, port);
     if ( m == 0x0 ) {
-      Serial.println(F("fa No such motor on port "));
-      char msg[3];
-      itoa(port, msg, 10);
-      Serial.println(msg);
+      say(MSG_NO_PORT, port);
       return 0x0;
     }
     return m;
@@ -34,8 +68,14 @@ class motorShield : public Adafruit_MotorShield {
   bool hasBegun(void) {return begun;}
 
  private:
+  static motorShield **registry(void) {
+    static motorShield *shields[MAX_SHIELDS] = {0x0, 0x0};
+    return shields;
+  }
+
   Adafruit_MotorShield AFMS;
   bool begun;
+  int  address;
 
 };
 #endif
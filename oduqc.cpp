@@ -6,19 +6,48 @@
 #include "readSerial.h"
 #include "circuit.h"
 #include "motorBoss.h"
+#include "telemetry.h"
+#include "bench.h"
+#include "trace.h"
+#include "memory.h"
+#include "messages.h"
+#include "storage.h"
 #include "config.h"
 
-bool CRASH_STOP  = false;
+// One of each, shared by every file
+readSerial *reader     = 0x0;
+command    *cmd        = 0x0;
+circuit    *controller = 0x0;
+motorBoss  *boss       = 0x0;
+
+// ...built in reserved storage rather than on the heap
+static staticSlot<readSerial> readerSlot;
+static staticSlot<circuit>    controllerSlot;
+static staticSlot<motorBoss>  bossSlot;
+
+volatile bool CRASH_STOP  = false;
 bool FATAL_ERROR = false;
 
+// Set by the panic interrupt, cleared once the main line has dealt with it
+volatile bool PANIC_PENDING = false;
+volatile unsigned long panicMicros = 0;
+unsigned long stopLatency = 0;
+
 void panicSwitch(void);
+void testODU(unsigned long);
+void dumpMap(uint8_t);
+void stageMap(const char *);
+void commitMap(const char *);
+void tuneAxis(char);
 
 // Run setup once, the first time through before loop()
 void setup() {
 
-  reader     = new readSerial();
+  reader     = readerSlot.make();
   cmd        = reader->getCmdPtr();
-  controller = new circuit();
+  controller = controllerSlot.make();
+
+  telem.setCommand(cmd);
 
   pinMode(interruptPin, INPUT_PULLUP);
   attachInterrupt(digitalPinToInterrupt(interruptPin), panicSwitch, LOW);
@@ -27,7 +56,7 @@ void setup() {
   randomSeed(analogRead(7));
 #endif
 
-  Serial.println(F("00 Ready"));
+  say(MSG_READY);
 
   return;
 } // End setup()
@@ -39,6 +68,9 @@ void loop() {
 
   int whichType = 0;
 
+  // Finish off a panic that happened while we were idle
+  panicHandler();
+
   // If there's available input, go get it
   if (reader->isAvailable()) {
 
@@ -62,25 +94,27 @@ void loop() {
     case 'i':
       // Define the response to the programs ID request
       //Serial.println(F("01 QCBot"));
-      Serial.println(F("01 ODUQC"));
+      say(MSG_IDENT);
       break;
 
     // Toggle GORT mode
     case 'G':
       if ( !boss ) {
-        boss = new motorBoss();
+        boss = bossSlot.make();
         boss->setType(cmd->steps);
+        telem.attach(boss);
       } 
-      Serial.println(F("a1 GORT is awake!"));
+      say(MSG_AWAKE);
       break;
     case 'g':
       if ( boss ) {
-        delete boss;
+        telem.attach(0x0);
+        bossSlot.destroy();
         boss = 0x0;
-        Serial.println(F("a2 Klautu barada nictu"));
+        say(MSG_ASLEEP);
       }
       else
-        Serial.println(F("GORT is sleeping"));
+        say(MSG_SLEEPING);
       break;
 
     case 'Q': case 'q':
@@ -99,13 +133,16 @@ void loop() {
         CRASH_STOP = false;
         if ( controller )
           controller->roxanne();
-        Serial.println(F("ff Crash Stop cleared"));
+
+        // The switch disarmed itself when it fired, so arm it again
+        attachInterrupt(digitalPinToInterrupt(interruptPin), panicSwitch, LOW);
+        say(MSG_CRASH_CLEARED);
       }
       else if (FATAL_ERROR) {
         FATAL_ERROR = false;
         if ( controller )
           controller->roxanne();
-        Serial.println(F("ff Fatal Error cleared"));
+        say(MSG_FATAL_CLEARED);
       }
       break;
 
@@ -130,7 +167,7 @@ void loop() {
 
       if ( controller ) {
         uint d = controller->setDelay( cmd->steps );
-        Serial.print(F("11 Delay set to "));Serial.println(d);
+        say(MSG_DELAY_SET, d);
       }
       break;
 
@@ -151,13 +188,71 @@ void loop() {
       if ( boss )
         boss->unPlug();
 
-      Serial.println(F("04 done"));
+      say(MSG_DONE);
 
-      if ( controller )
+      if ( controller ) {
+        BENCH_START(delayStart);
         delay( controller->getDelay() );
+        BENCH_STOP(BENCH_DELAY, delayStart);
+      }
 
       break;
 
+    case 'F':
+      // Run the whole ODU (or the connectors in the mask) in one go
+      if ( boss && controller ) {
+        unsigned long mask = strtoul(cmd->input+1, NULL, 0);
+        testODU( mask ? mask : ALL_CONNECTORS );
+      }
+      break;
+
+    case 'B':
+      // Negotiate a faster (or slower) line with the host
+      reader->setBaud( strtoul(cmd->input+1, NULL, 10) );
+      break;
+
+    case 'k':
+      // How fast can we actually push bytes at the current baud?
+      reader->throughput( cmd->steps ? (uint)cmd->steps : 1024 );
+      break;
+
+    case 'P':
+      // Periodic status frames, 'P 0' turns them off
+      if ( telem.setPeriod( (uint)cmd->steps ) ) {
+        say(MSG_TELEMETRY, telem.getPeriod());
+      }
+      else
+        say(MSG_TELEMETRY_OFF);
+      break;
+
+    case 'L':
+      // How long did the last panic take to get the coils off?
+      say(MSG_LATENCY, stopLatency);
+      break;
+
+    case 'M':
+      // Where has the SRAM gone?
+      memoryReport();
+      break;
+
+#ifdef BENCH
+    case 'j':
+      // Where has the time gone?
+      benchDump();
+      break;
+
+    case 'J':
+      benchReset();
+      say(MSG_BENCH_CLEARED);
+      break;
+#endif
+
+#ifdef TRACE
+    case 'd':
+      traceDump();
+      break;
+#endif
+
     case 'a':
       if ( boss ) 
         boss->checkPlacement( atoi(cmd->input) );
@@ -166,12 +261,7 @@ void loop() {
     case 'b':
       if ( controller ) {
         bool sub = controller->setSubtract((bool)(atoi(cmd->input)));
-        Serial.print(F("05 Background subtraction "));  
-
-        if ( sub )
-          Serial.println(F("on"));
-        else
-          Serial.println(F("off"));
+        say(MSG_SUBTRACT, sub ? "on" : "off");
       }
       break;
 
@@ -183,20 +273,14 @@ void loop() {
     case 'n':
       if ( controller ) {
         uint leds = controller->setNumLEDs(atoi(cmd->input));
-        Serial.print(F("06 Number of LEDs = ")); 
-        char msg[2];
-        itoa(leds, msg, 10);
-        Serial.println(msg);
+        say(MSG_NUM_LEDS, leds);
       }
       break;
 
     case 'S':
       if ( controller ) {
         uint samples = controller->setSampleSize(atoi(cmd->input));
-        Serial.print(F("07 Sample size = "));
-        char msg[4];
-        itoa(samples, msg, 10);
-        Serial.println(msg);
+        say(MSG_SAMPLES, samples);
       }
 
       break;
@@ -204,14 +288,14 @@ void loop() {
     case 'h':
       if ( boss ) {
         boss->home();
-        Serial.println(F("08 Motors parked"));
+        say(MSG_PARKED);
       }
       break;
 
     case 'm':
       if ( boss ) {
         boss->moveTo( cmd->steps );
-        Serial.println(F("09 Move Complete"));
+        say(MSG_MOVED);
       }
       break;
  
@@ -223,17 +307,18 @@ void loop() {
     case 'T':
       if ( boss ) {
         uint type = boss->setType((int)cmd->steps);
-        Serial.print(F("10 ODU type "));
-        ((int)(cmd->steps) % 2) ? Serial.println(F("odd")) : Serial.println(F("even"));
+        say(MSG_ODU_TYPE, ((int)(cmd->steps) % 2) ? "odd" : "even");
       }
       break;
 
     case 'e':
       echo = !echo;
-      if ( echo )
-        Serial.println(F("Echo on"));
-      else
-        Serial.println(F("Echo off"));
+      say(MSG_ECHO, echo ? "on" : "off");
+      break;
+
+    case 'v':
+      // Codes and numbers only, oduqc_decode puts the words back
+      say(MSG_TERSE, setTerse(!isTerse()) ? "on" : "off");
       break;
 
     case 'A':
@@ -305,6 +390,55 @@ void loop() {
         boss->unPlug();
       break;
 
+    case 'f':
+      // Slide from connector to connector backing off just clear of the pins, 'f 1' or 'f 0'
+      if ( boss )
+        say(MSG_SLIDE, boss->setSlide((bool)(atoi(cmd->input+1))) ? "on" : "off");
+      break;
+
+    case 'o':
+      // Take the dark baseline on the way to each connector, 'o 1' or 'o 0'
+      if ( controller )
+        say(MSG_PREFETCH, controller->setPrefetch((bool)(atoi(cmd->input+1))) ? "on" : "off");
+      break;
+
+    case 'E':
+      // What the limit switches have caught of lost steps
+      if ( boss )
+        boss->drift();
+      break;
+
+    case 'u':
+      // 'u X' tunes X's speed, 'u 0' goes back to config.h's, 'u' says what they are
+      if ( boss ) {
+        const char *arg = cmd->input + 1;
+        while ( *arg == ' ' )
+          arg++;
+        if ( isalpha(*arg) ) {
+          tuneAxis(*arg);
+          break;
+        }
+        if ( *arg == '0' )
+          boss->resetSpeeds();
+        boss->speeds();
+      }
+      break;
+
+    case 'V':
+      // The connector map for a type, the boss's if there's no type
+      dumpMap( cmd->steps ? (uint8_t)cmd->steps : (boss ? boss->getType() : 1) );
+      break;
+
+    case 'W':
+      // Part of a new map, "W <type> <offset> <hex bytes>"
+      stageMap(cmd->input+1);
+      break;
+
+    case 'w':
+      // Keep the new map if it came through, "w <type> <crc>"
+      commitMap(cmd->input+1);
+      break;
+
     default:
       Serial.print(cmd->operation);
       Serial.print(cmd->input);
@@ -319,12 +453,12 @@ void loop() {
       FATAL_ERROR = true;
       if ( controller )
         controller->roxanne();
-      Serial.println(F("fe Fatal Error: Too much light in the box"));
+      say(MSG_LIGHT_LEAK);
     }
   }
   else if ( FATAL_ERROR ) {
     FATAL_ERROR = false;
-    Serial.println(F("ff Fatal Error: light leak cleared"));
+    say(MSG_LEAK_CLEARED);
     if ( controller )
       controller->roxanne();
   }
@@ -335,20 +469,266 @@ void loop() {
       boss->unlockMotors();
   }
 
-  delay(500);
+  telem.wait(500);
 
   return;
   
 } // End loop()
 
+/*
+ * Walk the connectors in <mask> (bit 0 == connector 1) for the ODU
+ * type already set in the boss: move, plug, light 'em up and unplug,
+ * all without waiting on the Pi between connectors. Any panic, light
+ * leak or stop request from the line ends the run with everything
+ * unplugged.
+ */
+void testODU(unsigned long mask) {
+
+  bool aborted = false;
+  uint connector;
+
+  for ( connector=1; connector<=NUM_CONNECTORS; connector++ ) {
+
+    if ( !(mask & (1UL<<(connector-1))) )
+      continue;
+
+    say(MSG_CONNECTOR, connector);
+
+    // Clear the reader so we notice a stop request along the way
+    reader->flushCommand();
+
+    boss->moveTo(connector);
+    if ( CRASH_STOP || FATAL_ERROR || cmd->operation == 's' || cmd->operation == 'S' ) {
+      aborted = true;
+      break;
+    }
+
+    boss->plugIn();
+    controller->sequence();
+
+    // Sliding, the next move backs off only as far as it has to
+    if ( !boss->getSlide() )
+      boss->unPlug();
+
+    if ( CRASH_STOP || FATAL_ERROR || cmd->operation == 's' || cmd->operation == 'S' ) {
+      aborted = true;
+      break;
+    }
+
+    say(MSG_DONE);
+  }
+
+  if ( aborted ) {
+    // Don't drag the connector around if the robot is panicking
+    if ( !CRASH_STOP && !FATAL_ERROR )
+      boss->unPlug();
+    boss->unlockMotors();
+    say(MSG_ODU_ABORTED, connector);
+  }
+  else {
+    if ( boss->getSlide() )
+      boss->unPlug();
+    say(MSG_ODU_DONE);
+  }
+
+  reader->flushCommand();
+
+  return;
+}
+
 /*
  * Hitting the panic switch brings us here, where we 
- * stop whatever's going on in the robot
+ * stop whatever's going on in the robot. This is interrupt
+ * context, so just disarm the switch (a LOW interrupt fires for
+ * as long as the button is held), raise the flag and leave the
+ * I2C and serial traffic to panicHandler()
  */
 void panicSwitch(void) {
+  detachInterrupt(digitalPinToInterrupt(interruptPin));
   if ( !CRASH_STOP ) {
-    Serial.println(F("fd PANICING!"));
-    CRASH_STOP = true;
+    panicMicros   = micros();
+    CRASH_STOP    = true;
+    PANIC_PENDING = true;
+  }
+  return;
+}
+
+/*
+ * Called from the step loops and the main loop. The first call after
+ * the switch fires cuts the coil current on both shields, notes how
+ * long that took and tells the host
+ */
+void panicHandler(void) {
+  if ( !PANIC_PENDING )
+    return;
+
+  motorShield::cutAll();
+  stopLatency   = micros() - panicMicros;
+  PANIC_PENDING = false;
+
+  say(MSG_PANIC);
+  return;
+}
+
+/*
+ * Connector maps (connectorMap.h) go up from the host as the raw bytes
+ * of a connectorMap, in hex and at most 8 bytes a line so each fits the
+ * serial line:
+ *
+ *   W 1 0 c2012e00d5014502     -> 26 Map 1 staged 0
+ *   ...                           (offsets 0, 8, ... 152)
+ *   w 1 3f5a                   -> 27 Map 1 saved slot 1 sequence 2
+ *
+ * Each piece goes straight into the EEPROM slot the map will take, and
+ * the 'w' seals it only if the CRC-CCITT of the whole lot is the one
+ * given, so a line lost on the way leaves the old map in place. 'V'
+ * sends it back with the same CRC.
+ */
+static uint8_t mapType( const char *text, char **end ) {
+  unsigned long type = strtoul(text, end, 10);
+  return (type == 1 || type == 3) ? 1 : (type == 2 || type == 4) ? 2 : 0;
+}
+
+void dumpMap(uint8_t type) {
+
+  type = (type % 2) ? 1 : 2;
+  recordArea area = motorBoss::mapArea(type);
+  uint32_t zFirst, sequence = 0;
+  int8_t slot = recordPeek(area, sizeof(connectorMap), offsetof(connectorMap, zFirst), &zFirst,
+                           sizeof(zFirst), &sequence);
+
+  uint16_t crc = 0xFFFF;
+  if ( slot < 0 )
+    zFirst = 0;
+  for ( uint8_t i=0; i<MAP_ENTRIES; i++ ) {
+    connectorPos p;
+    if ( slot >= 0 )
+      recordPeek(area, sizeof(connectorMap), i * sizeof(p), &p, sizeof(p));
+    else if ( builtInPos(type, i + 1, &p) )
+      zFirst |= 1UL << i;
+    crc = recordCRC(&p, sizeof(p), crc);
+    say(MSG_MAP_ENTRY, type, i + 1, (int)p.x, (int)p.y, (int)p.z, (int)p.r, (uint)((zFirst >> i) & 1));
+  }
+  crc = recordCRC(&zFirst, sizeof(zFirst), crc);
+  say(MSG_MAP, type, (uint)crc, slot, (unsigned long)sequence);
+  return;
+}
+
+void stageMap(const char *text) {
+
+  char *at;
+  uint8_t type = mapType(text, &at);
+  unsigned long offset = strtoul(at, &at, 10);
+
+  uint8_t data[8], n = 0;
+  while ( *at == ' ' )
+    at++;
+  while ( n < sizeof(data) && isxdigit(at[0]) && isxdigit(at[1]) ) {
+    char pair[3] = { at[0], at[1], '\0' };
+    data[n++] = strtoul(pair, NULL, 16);
+    at += 2;
+  }
+
+  if ( !type || !n || isxdigit(*at) || offset > sizeof(connectorMap) ||
+       recordStage(motorBoss::mapArea(type), sizeof(connectorMap), offset, data, n) < 0 ) {
+    say(MSG_MAP_REJECTED, type);
+    return;
+  }
+  say(MSG_MAP_STAGED, type, (uint)offset);
+  return;
+}
+
+void commitMap(const char *text) {
+
+  char *at;
+  uint8_t type = mapType(text, &at);
+  uint16_t crc = strtoul(at, NULL, 16);
+
+  uint32_t sequence;
+  int8_t slot = type ? recordCommit(motorBoss::mapArea(type), sizeof(connectorMap), crc, &sequence) : -1;
+  if ( slot < 0 ) {
+    say(MSG_MAP_REJECTED, type);
+    return;
+  }
+
+  // The boss moves by its cached copy, so it needs the new one now
+  if ( boss && boss->getType() == type )
+    boss->loadMap();
+  say(MSG_MAP_SAVED, type, slot, (unsigned long)sequence);
+  return;
+}
+
+/*
+ * Find the fastest <axis> goes without losing steps. Each round is
+ * TUNE_CYCLES trips out TUNE_TRAVEL steps and back home, and the limit
+ * switch checks the count every time it gets there, so a round that
+ * always finds the switch and never needs a correction is one that lost
+ * nothing. Rounds start at config.h's speed and go up by TUNE_GROWTH
+ * percent of it until one loses steps or TUNE_CEILING is reached. The
+ * fastest clean one less TUNE_MARGIN (but never below config.h's) is
+ * what it keeps, and saves for next time. Stopped part way, it keeps the
+ * speed it had.
+ */
+void tuneAxis(char axis) {
+
+  int8_t i = axisIndex(axis);
+  axisMotor *motor = boss->getMotorPtr(axis);
+  if ( !motor ) {
+    say(MSG_NO_MOTOR);
+    return;
+  }
+  axis = motor->getAxis();
+
+  // Everything home first so nothing's in the way, and this axis' count is good
+  boss->home();
+  reader->flushCommand();
+
+  uint base = motorBoss::defaultSpeed(i), was = motor->getSpeed(), best = 0;
+  uint grow = base * TUNE_GROWTH / 100;
+  if ( !grow )
+    grow = 1;
+
+  bool stopped = false;
+  for ( uint rpm=base; rpm<=TUNE_CEILING*base; rpm+=grow ) {
+
+    motor->setSpeed(rpm);
+    uint16_t before = motor->getCorrections();
+    bool clean = true;
+    for ( uint8_t c=0; c<TUNE_CYCLES && clean && !stopped; c++ ) {
+      motor->stepMotor(TUNE_TRAVEL);
+      motor->home();
+      clean   = motor->foundSwitch() && motor->getCorrections() == before;
+      stopped = CRASH_STOP || FATAL_ERROR || cmd->operation == 's' || cmd->operation == 'S';
+    }
+    if ( stopped )
+      break;
+
+    say(MSG_TUNE_TRY, axis, rpm, clean ? "clean" : "lost steps");
+    if ( !clean ) {
+      // Wherever that left it, find the switch again at a speed it can do
+      motor->setSpeed(best ? best : base);
+      motor->home();
+      break;
+    }
+    best = rpm;
+  }
+
+  if ( stopped ) {
+    motor->setSpeed(was);
+    say(MSG_TUNED, axis, was, -1);
+    return;
+  }
+
+  // Nothing clean: config.h's speed for now, and whatever was saved
+  // before stays saved
+  if ( !best ) {
+    motor->setSpeed(base);
+    say(MSG_TUNE_FAILED, axis, base);
+    return;
   }
+
+  uint keep = best * (100 - TUNE_MARGIN) / 100;
+  motor->setSpeed( (keep > base) ? keep : base );
+  say(MSG_TUNED, axis, motor->getSpeed(), boss->saveSpeeds());
   return;
 }
@@ -0,0 +1,188 @@
+#include "analysis.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <thread>
+#include <algorithm>
+
+bool loadEpochs( const char *file, std::vector<calibrationEpoch> &epochs ) {
+
+  FILE *in = fopen(file, "r");
+  if ( !in ) {
+    perror(file);
+    return false;
+  }
+
+  char line[512];
+  unsigned n = 0;
+  bool ok = true;
+  while ( ok && fgets(line, sizeof(line), in) ) {
+    n++;
+    line[strcspn(line, "#\r\n")] = '\0';
+
+    char when[64];
+    int used;
+    if ( sscanf(line, "%63s%n", when, &used) != 1 )
+      continue;
+
+    calibrationEpoch e;
+    e.fromMs = storeTime(when);
+    const char *p = line + used;
+    unsigned i;
+    for ( i=0; i<STORE_LEDS; i++ ) {
+      if ( sscanf(p, "%f%n", &e.norm[i], &used) != 1 )
+        break;
+      p += used;
+    }
+    if ( (!e.fromMs && strcmp(when, "0")) || i != STORE_LEDS ) {
+      fprintf(stderr, "%s:%u: want <when> and %d normalizations\n", file, n, STORE_LEDS);
+      ok = false;
+    }
+    else
+      epochs.push_back(e);
+  }
+  fclose(in);
+
+  std::stable_sort(epochs.begin(), epochs.end(), [](const calibrationEpoch &a, const calibrationEpoch &b) {
+    return a.fromMs < b.fromMs;
+  });
+  if ( epochs.size() >= EPOCH_STORED ) {
+    fprintf(stderr, "%s: more than %d epochs\n", file, EPOCH_STORED - 1);
+    ok = false;
+  }
+  return ok;
+}
+
+uint8_t epochAt( const std::vector<calibrationEpoch> &epochs, uint64_t ms ) {
+  size_t n = std::upper_bound(epochs.begin(), epochs.end(), ms, [](uint64_t t, const calibrationEpoch &e) {
+    return t < e.fromMs;
+  }) - epochs.begin();
+  return n ? n - 1 : EPOCH_STORED;
+}
+
+void analyzeChunk( const oduChunk *c, const float *norm, const passCriteria &pass,
+                   oduVerdict *v, float (*ratios)[STORE_LEDS] ) {
+
+  v->verdict    = VERDICT_PASS;
+  v->fibers     = v->failed = 0;
+  v->worstRatio = 1.0f;
+  memset(v->failMask, 0, sizeof(v->failMask));
+
+  // What each LED's Lmean gets multiplied by. A stored 0 can't be undone
+  float gain[STORE_LEDS];
+  uint32_t unknown = 0;
+  for ( unsigned i=0; i<STORE_LEDS; i++ ) {
+    float was = c->normalization[i];
+    gain[i] = norm ? (was > 0.0f ? norm[i] / was : 0.0f) : 1.0f;
+    if ( norm && was <= 0.0f )
+      unknown |= 1UL << i;
+  }
+
+  float worst = 0.0f;
+  for ( unsigned k=0; k<NUM_CONNECTORS; k++ ) {
+    uint32_t measured = c->ledMask[k];
+    if ( !measured )
+      continue;
+    if ( measured & unknown ) {
+      v->verdict = VERDICT_UNKNOWN;
+      return;
+    }
+
+    // The kernel: straight line over the columns (& not &&, so there's
+    // no branch to stop it vectorizing). A NaN compares false and fails
+    const float *lm = c->lmean[k], *ls = c->lstdev[k], *sm = c->smean[k];
+    const float lo = pass.minRatio, hi = pass.maxRatio, most = pass.maxNoise;
+    float ratio[STORE_LEDS], off[STORE_LEDS];
+    int32_t bad[STORE_LEDS];
+    for ( unsigned i=0; i<STORE_LEDS; i++ ) {
+      float r     = lm[i] * gain[i] / sm[i];
+      float noise = ls[i] / lm[i];
+      ratio[i] = r;
+      off[i]   = fabsf(r - 1.0f);
+      bad[i]   = ((r >= lo) & (r <= hi) & (noise <= most)) ^ 1;
+    }
+
+    uint32_t failed = 0;
+    for ( unsigned i=0; i<STORE_LEDS; i++ )
+      failed |= (uint32_t)bad[i] << i;
+    failed &= measured;
+
+    for ( uint32_t m=measured; m; m&=m-1 ) {
+      unsigned i = __builtin_ctz(m);
+      if ( !(off[i] <= worst) ) {
+        worst = off[i];
+        v->worstRatio = ratio[i];
+      }
+    }
+    if ( ratios )
+      memcpy(ratios[k], ratio, sizeof(ratio));
+
+    v->failMask[k] = failed;
+    v->fibers += __builtin_popcount(measured);
+    v->failed += __builtin_popcount(failed);
+  }
+
+  if ( v->failed )
+    v->verdict = VERDICT_FAIL;
+  return;
+}
+
+// Chunks [from, to) on one thread
+static void analyzeRange( const resultReader &store, const std::vector<calibrationEpoch> &epochs,
+                          const passCriteria &pass, oduVerdict *out, size_t from, size_t to,
+                          analysisTotals *totals ) {
+  memset(totals, 0, sizeof(*totals));
+  for ( size_t n=from; n<to; n++ ) {
+    oduVerdict &v = out[n];
+    const oduChunk *c = store.chunk(n);
+    v.chunk = n;
+    v.epoch = EPOCH_STORED;
+    if ( !c || c->status != 1 ) {              // REPLY_DONE
+      v.verdict = VERDICT_SKIPPED;
+      v.fibers  = v.failed = 0;
+      totals->odus[VERDICT_SKIPPED]++;
+      continue;
+    }
+    v.epoch = epochAt(epochs, c->startMs);
+    analyzeChunk(c, v.epoch == EPOCH_STORED ? 0x0 : epochs[v.epoch].norm, pass, &v);
+    totals->odus[v.verdict]++;
+    totals->fibers += v.fibers;
+    totals->failed += v.failed;
+  }
+  return;
+}
+
+analysisTotals analyzeStore( const resultReader &store, const std::vector<calibrationEpoch> &epochs,
+                             const passCriteria &pass, std::vector<oduVerdict> &out, unsigned threads ) {
+
+  size_t count = store.count();
+  out.resize(count);
+
+  if ( !threads )
+    threads = std::max(1u, std::thread::hardware_concurrency());
+
+  // Not worth a thread for less than a few hundred ODUs
+  threads = std::min<size_t>(threads, std::max<size_t>(1, count / 256));
+
+  std::vector<analysisTotals> part(threads);
+  std::vector<std::thread> workers;
+  size_t per = (count + threads - 1) / threads;
+  for ( unsigned t=1; t<threads; t++ ) {
+    size_t from = std::min(count, t * per), to = std::min(count, from + per);
+    workers.push_back(std::thread(analyzeRange, std::cref(store), std::cref(epochs), std::cref(pass),
+                                  out.data(), from, to, &part[t]));
+  }
+  analyzeRange(store, epochs, pass, out.data(), 0, std::min(count, per), &part[0]);
+
+  analysisTotals sum;
+  memset(&sum, 0, sizeof(sum));
+  for ( unsigned t=0; t<threads; t++ ) {
+    if ( t )
+      workers[t-1].join();
+    for ( unsigned i=0; i<4; i++ )
+      sum.odus[i] += part[t].odus[i];
+    sum.fibers += part[t].fibers;
+    sum.failed += part[t].failed;
+  }
+  return sum;
+}
@@ -0,0 +1,84 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "resultStore.h"
+
+/*
+ * Pass/fail over a result store under any calibration. The stand's
+ * circuit::calibrate() sets normalization[i] = Smean/Lmean once, and
+ * every Lmean after that left the stand already multiplied by it. The
+ * chunk keeps the normalization that was in use, so the raw number
+ * comes back out by dividing, and goes back in under another epoch's:
+ *
+ *   Lmean' = Lmean * epoch[i] / chunk.normalization[i]
+ *   ratio  = Lmean' / Smean                     1.0 for a perfect fiber
+ *   noise  = Lstdev / Lmean                     the same under any epoch
+ *
+ * A fiber passes if its ratio is in [minRatio, maxRatio] and its noise
+ * is at most maxNoise, and an ODU passes if every fiber it measured does.
+ *
+ * The store is split across threads by chunk, and within a chunk each
+ * connector is one pass over 18 contiguous floats per column with no
+ * branches, which the compiler turns into NEON/SSE on its own.
+ */
+
+#define EPOCH_STORED     0xFF     // no epoch, use what the chunk has
+#define ANALYSIS_THREADS 0        // 0 is one per core
+
+#define PASS_MIN_RATIO   0.80f    // Lmean'/Smean of a good fiber
+#define PASS_MAX_RATIO   1.20f
+#define PASS_MAX_NOISE   0.20f    // Lstdev/Lmean
+
+struct calibrationEpoch {
+  uint64_t fromMs;                // applies to ODUs started at or after this
+  float    norm[STORE_LEDS];
+};
+
+struct passCriteria {
+  float minRatio, maxRatio;
+  float maxNoise;
+};
+
+enum {
+  VERDICT_PASS,
+  VERDICT_FAIL,
+  VERDICT_UNKNOWN,                // the chunk has no normalization to undo
+  VERDICT_SKIPPED                 // unsealed, or not a finished ODU
+};
+
+struct oduVerdict {
+  uint32_t chunk;
+  uint8_t  verdict;
+  uint8_t  epoch;                 // index into the epochs, or EPOCH_STORED
+  uint16_t fibers;                // measured
+  uint16_t failed;
+  float    worstRatio;            // furthest from 1.0
+  uint32_t failMask[NUM_CONNECTORS];
+};
+
+struct analysisTotals {
+  size_t odus[4];                 // by verdict
+  size_t fibers, failed;
+};
+
+// Sorted epochs from a text file, one per line: <when> <norm 0> ... <norm 17>
+// (when as in storeTime()), # for comments. False and a message if it's bad
+bool loadEpochs ( const char *file, std::vector<calibrationEpoch> &epochs );
+
+// The epoch in force at <ms>, or EPOCH_STORED
+uint8_t epochAt ( const std::vector<calibrationEpoch> &epochs, uint64_t ms );
+
+// One chunk under <norm> (null for the stored one); fills <v> and, if
+// <ratios> isn't null, every fiber's ratio into it ([connector][led])
+void analyzeChunk ( const oduChunk *c, const float *norm, const passCriteria &pass,
+                    oduVerdict *v, float (*ratios)[STORE_LEDS] = 0x0 );
+
+// The whole store, one verdict per chunk in <out>
+analysisTotals analyzeStore ( const resultReader &store, const std::vector<calibrationEpoch> &epochs,
+                              const passCriteria &pass, std::vector<oduVerdict> &out,
+                              unsigned threads = ANALYSIS_THREADS );
+
+#endif
@@ -0,0 +1,145 @@
+/*
+ * Pass/fail for every ODU in one or more result stores, under the
+ * normalizations they were measured with or any calibration epochs
+ * (analysis.h):
+ *
+ *   oduqc_analyze [-e epochs | -k norm] [-m min] [-M max] [-z noise] [-j threads] [-l | -f] store.oqr ...
+ *
+ *   -e file     calibration epochs, "<when> <norm 0> ... <norm 17>" a line
+ *   -k norm     one normalization for every LED, from the beginning of time
+ *   -m / -M     the ratio a fiber has to be inside (0.80 - 1.20)
+ *   -z noise    the most Lstdev/Lmean a fiber can have (0.20)
+ *   -j n        threads, one per core by default
+ *   -l          a line per ODU: serial, epoch, verdict, fibers, failed, worst ratio
+ *   -f          a line per failed fiber: serial, connector, LED, ratio
+ *
+ * The totals and how long it took go to stderr.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include "analysis.h"
+
+static const char *verdictName[] = { "pass", "fail", "unknown", "skipped" };
+
+static uint64_t usNow(void) {
+  struct timeval tv;
+  gettimeofday(&tv, 0x0);
+  return tv.tv_sec * 1000000ULL + tv.tv_usec;
+}
+
+static int usage( const char *name ) {
+  fprintf(stderr, "usage: %s [-e epochs | -k norm] [-m min] [-M max] [-z noise] [-j threads] [-l | -f] store.oqr ...\n",
+          name);
+  return 2;
+}
+
+int main(int argc, char **argv) {
+
+  std::vector<calibrationEpoch> epochs;
+  passCriteria pass = { PASS_MIN_RATIO, PASS_MAX_RATIO, PASS_MAX_NOISE };
+  unsigned threads = ANALYSIS_THREADS;
+  char mode = 's';
+
+  int opt;
+  while ( (opt = getopt(argc, argv, "e:k:m:M:z:j:lf")) != -1 ) {
+    switch ( opt ) {
+    case 'e':
+      if ( !loadEpochs(optarg, epochs) )
+        return 2;
+      break;
+    case 'k': {
+      calibrationEpoch e;
+      e.fromMs = 0;
+      for ( unsigned i=0; i<STORE_LEDS; i++ )
+        e.norm[i] = atof(optarg);
+      epochs.insert(epochs.begin(), e);
+      break;
+    }
+    case 'm':
+      pass.minRatio = atof(optarg);
+      break;
+    case 'M':
+      pass.maxRatio = atof(optarg);
+      break;
+    case 'z':
+      pass.maxNoise = atof(optarg);
+      break;
+    case 'j':
+      threads = strtoul(optarg, NULL, 0);
+      break;
+    case 'l':
+    case 'f':
+      mode = opt;
+      break;
+    default:
+      return usage(argv[0]);
+    }
+  }
+  if ( optind >= argc )
+    return usage(argv[0]);
+
+  if ( mode == 'l' )
+    printf("serial\tepoch\tverdict\tfibers\tfailed\tworst\n");
+  else if ( mode == 'f' )
+    printf("serial\tconnector\tled\tratio\n");
+
+  analysisTotals total;
+  memset(&total, 0, sizeof(total));
+  uint64_t scanning = 0;
+
+  for ( int a=optind; a<argc; a++ ) {
+
+    resultReader store;
+    if ( !store.open(argv[a]) ) {
+      perror(argv[a]);
+      continue;
+    }
+
+    std::vector<oduVerdict> verdicts;
+    uint64_t began = usNow();
+    analysisTotals t = analyzeStore(store, epochs, pass, verdicts, threads);
+    scanning += usNow() - began;
+
+    for ( unsigned i=0; i<4; i++ )
+      total.odus[i] += t.odus[i];
+    total.fibers += t.fibers;
+    total.failed += t.failed;
+
+    // Printing is the slow part, so it comes after the clock's stopped
+    for ( size_t n=0; n<verdicts.size() && mode != 's'; n++ ) {
+      const oduVerdict &v = verdicts[n];
+      const oduChunk *c = store.chunk(n);
+      if ( v.verdict == VERDICT_SKIPPED )
+        continue;
+
+      if ( mode == 'l' ) {
+        printf("%.32s\t", c->serial);
+        if ( v.epoch == EPOCH_STORED )
+          printf("stored");
+        else
+          printf("%u", v.epoch);
+        printf("\t%s\t%u\t%u\t%.3f\n", verdictName[v.verdict], v.fibers, v.failed, v.worstRatio);
+        continue;
+      }
+
+      if ( v.verdict != VERDICT_FAIL )
+        continue;
+      float ratios[NUM_CONNECTORS][STORE_LEDS];
+      oduVerdict again;
+      analyzeChunk(c, v.epoch == EPOCH_STORED ? 0x0 : epochs[v.epoch].norm, pass, &again, ratios);
+      for ( unsigned k=0; k<NUM_CONNECTORS; k++ )
+        for ( uint32_t m=v.failMask[k]; m; m&=m-1 ) {
+          unsigned i = __builtin_ctz(m);
+          printf("%.32s\t%u\t%u\t%.3f\n", c->serial, k + 1, i, ratios[k][i]);
+        }
+    }
+  }
+
+  fprintf(stderr, "analyze: %zu ODUs passed, %zu failed, %zu unknown, %zu skipped; %zu of %zu fibers failed in %.3f ms\n",
+          total.odus[VERDICT_PASS], total.odus[VERDICT_FAIL], total.odus[VERDICT_UNKNOWN], total.odus[VERDICT_SKIPPED],
+          total.failed, total.fibers, scanning / 1e3);
+  return (total.odus[VERDICT_FAIL] || total.odus[VERDICT_UNKNOWN]) ? 1 : 0;
+}
@@ -0,0 +1,218 @@
+/*
+ * Drives a stand from the command line through standClient, and shows
+ * how the library is meant to be used: every command is queued up front
+ * and each prints as its reply comes in.
+ *
+ *   oduqc_client [-v] [-b baud] [-w boot_ms] /dev/ttyACM0 command ...
+ *
+ * Commands, each with its arguments:
+ *
+ *   id  wake TYPE  sleep  type N  move N  home  rehome  in  out  unlock
+ *   step AXIS STEPS  rotate DEG  pos  drift  speeds  tune AXIS  seq
+ *   odu [MASK]  cal  delay MS  leds N  samples N  subtract 0|1  slide 0|1
+ *   dark 0|1  telemetry MS  terse  clear  baud RATE  raw LINE  map TYPE
+ *   setmap TYPE FILE
+ *
+ * Each one prints "<command> <status> <ms> [value]". seq and odu add a
+ * line per LED (connector led nonce Lmean Lstdev Smean Sstdev), and map
+ * one per connector (connector x y z r high). setmap takes a file of
+ * those lines (mapFile.h). -v
+ * echoes the stand's lines to stderr. Against the simulator:
+ *
+ *   ./oduqc_host -s -x 100 -p /tmp/oduqc &
+ *   ./oduqc_client -w 0 /tmp/oduqc wake 1 move 3 seq home
+ *
+ * Exits 1 if anything didn't come back done.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include "standClient.h"
+#include "mapFile.h"
+
+static const char *statusName[] = { "pending", "done", "failed", "timeout", "closed" };
+
+static unsigned outstanding = 0, failures = 0;
+
+// Print <r> under <name> once it's back
+template <class T>
+static void report( const char *name, reply<T> r, std::function<void(const T &)> show ) {
+  uint64_t start = eventLoop::nowMs();
+  outstanding++;
+  r.then([=](const reply<T> &done) {
+    printf("%s\t%s\t%lu", name, statusName[done.status()], (unsigned long)(eventLoop::nowMs() - start));
+    if ( done.fault() >= 0 )
+      printf("\tfault %d", done.fault());
+    if ( done.ok() && show )
+      show(done.get());
+    printf("\n");
+    fflush(stdout);
+    if ( !done.ok() )
+      failures++;
+    outstanding--;
+  });
+}
+
+static void printLEDs( unsigned connector, const sequenceResult &s ) {
+  for ( unsigned i=0; i<s.count; i++ ) {
+    const ledResult &l = s.leds[i];
+    printf("\n%u\t%u\t%d\t%.2f\t%.2f\t%.2f\t%.2f", connector, l.led, l.nonce, l.lmean, l.lstdev, l.smean, l.sstdev);
+  }
+}
+
+static int usage( const char *name ) {
+  fprintf(stderr, "usage: %s [-v] [-b baud] [-w boot_ms] device command ...\n", name);
+  return 2;
+}
+
+int main(int argc, char **argv) {
+
+  uint32_t baud = BAUD, boot = CLIENT_BOOT;
+  bool verbose = false;
+
+  int opt;
+  while ( (opt = getopt(argc, argv, "vb:w:")) != -1 ) {
+    switch ( opt ) {
+    case 'v':
+      verbose = true;
+      break;
+    case 'b':
+      baud = strtoul(optarg, NULL, 0);
+      break;
+    case 'w':
+      boot = strtoul(optarg, NULL, 0);
+      break;
+    default:
+      return usage(argv[0]);
+    }
+  }
+  if ( optind >= argc )
+    return usage(argv[0]);
+
+  eventLoop loop;
+  standClient stand(loop);
+  if ( !stand.open(argv[optind], baud, boot) ) {
+    perror(argv[optind]);
+    return 2;
+  }
+  if ( verbose )
+    stand.onLine = [](const standLine &line) { fprintf(stderr, "> %s\n", line.text); };
+  stand.onClose = [&loop]() { fprintf(stderr, "line closed\n"); loop.stop(); };
+
+  std::function<void(const bool &)>     yes    = nullptr;
+  std::function<void(const unsigned &)> number = [](const unsigned &v) { printf("\t%u", v); };
+
+  for ( int i=optind+1; i<argc; i++ ) {
+    const char *c = argv[i];
+    const char *arg = (i + 1 < argc) ? argv[i+1] : "0";
+    bool used = true;
+
+    if      ( !strcmp(c, "id") )        {report(c, stand.identify(), yes); used = false;}
+    else if ( !strcmp(c, "wake") )      report(c, stand.wake(atoi(arg)), yes);
+    else if ( !strcmp(c, "sleep") )     {report(c, stand.sleep(), yes); used = false;}
+    else if ( !strcmp(c, "type") )      report(c, stand.setType(atoi(arg)), number);
+    else if ( !strcmp(c, "move") )      report(c, stand.moveTo(atoi(arg)), yes);
+    else if ( !strcmp(c, "home") )      {report(c, stand.home(), yes); used = false;}
+    else if ( !strcmp(c, "rehome") )    {report(c, stand.resetHome(), yes); used = false;}
+    else if ( !strcmp(c, "in") )        {report(c, stand.plugIn(), yes); used = false;}
+    else if ( !strcmp(c, "out") )       {report(c, stand.unPlug(), yes); used = false;}
+    else if ( !strcmp(c, "unlock") )    {report(c, stand.unlock(), yes); used = false;}
+    else if ( !strcmp(c, "rotate") )    report(c, stand.rotate(atof(arg)), yes);
+    else if ( !strcmp(c, "delay") )     report(c, stand.setDelay(atoi(arg)), number);
+    else if ( !strcmp(c, "leds") )      report(c, stand.setLEDs(atoi(arg)), number);
+    else if ( !strcmp(c, "samples") )   report(c, stand.setSamples(atoi(arg)), number);
+    else if ( !strcmp(c, "telemetry") ) report(c, stand.setTelemetry(atoi(arg)), number);
+    else if ( !strcmp(c, "raw") )       report(c, stand.command(arg), yes);
+    else if ( !strcmp(c, "cal") )       {report(c, stand.calibrate(), yes); used = false;}
+    else if ( !strcmp(c, "subtract") )
+      report<bool>(c, stand.setSubtract(atoi(arg)), [](const bool &on) { printf("\t%s", on ? "on" : "off"); });
+    else if ( !strcmp(c, "slide") )
+      report<bool>(c, stand.setSlide(atoi(arg)), [](const bool &on) { printf("\t%s", on ? "on" : "off"); });
+    else if ( !strcmp(c, "dark") )
+      report<bool>(c, stand.setPrefetch(atoi(arg)), [](const bool &on) { printf("\t%s", on ? "on" : "off"); });
+    else if ( !strcmp(c, "terse") ) {
+      report<bool>(c, stand.toggleTerse(), [](const bool &on) { printf("\t%s", on ? "on" : "off"); });
+      used = false;
+    }
+    else if ( !strcmp(c, "clear") ) {
+      report<bool>(c, stand.clearFaults(), [](const bool &was) { printf("\t%s", was ? "cleared" : "nothing"); });
+      used = false;
+    }
+    else if ( !strcmp(c, "baud") )
+      report<uint32_t>(c, stand.setBaud(strtoul(arg, NULL, 0)), [](const uint32_t &b) { printf("\t%u", b); });
+    else if ( !strcmp(c, "drift") ) {
+      report<driftReport>(c, stand.drift(), [](const driftReport &d) {
+        for ( int i=0; i<4; i++ )
+          printf("\t%u\t%d", d.corrections[i], d.last[i]);
+      });
+      used = false;
+    }
+    else if ( !strcmp(c, "speeds") ) {
+      report<axisSpeeds>(c, stand.speeds(), [](const axisSpeeds &a) {
+        printf("\t%u\t%u\t%u\t%u", a.rpm[0], a.rpm[1], a.rpm[2], a.rpm[3]);
+      });
+      used = false;
+    }
+    else if ( !strcmp(c, "tune") )
+      report(c, stand.tune(*arg), number);
+    else if ( !strcmp(c, "pos") ) {
+      report<headPosition>(c, stand.position(), [](const headPosition &h) {
+        printf("\t%.2f\t%.2f\t%.2f\t%.2f", h.x, h.y, h.z, h.r);
+      });
+      used = false;
+    }
+    else if ( !strcmp(c, "map") ) {
+      report<mapReading>(c, stand.readMap(atoi(arg)), [](const mapReading &m) {
+        printf("\t%u\t%04x\t%d\t%u", m.type, m.crc, m.slot, m.sequence);
+        for ( unsigned k=0; k<MAP_ENTRIES; k++ ) {
+          const connectorPos &p = m.map.pos[k];
+          printf("\n%u\t%d\t%d\t%d\t%d\t%u", k + 1, p.x, p.y, p.z, p.r, (unsigned)((m.map.zFirst >> k) & 1));
+        }
+      });
+    }
+    else if ( !strcmp(c, "setmap") && i + 2 < argc ) {
+      connectorMap map;
+      unsigned type = atoi(argv[i+1]);
+      if ( !readMapFile(argv[i+2], type, &map) )
+        return 2;
+      report<bool>(c, stand.writeMap(type, map), [](const bool &kept) { printf("\t%s", kept ? "kept" : "rejected"); });
+      i++;
+    }
+    else if ( !strcmp(c, "step") && i + 2 < argc ) {
+      report(c, stand.step(argv[i+1][0], atof(argv[i+2])), yes);
+      i++;
+    }
+    else if ( !strcmp(c, "seq") ) {
+      report<sequenceResult>(c, stand.sequence(), [](const sequenceResult &s) { printLEDs(0, s); });
+      used = false;
+    }
+    else if ( !strcmp(c, "odu") ) {
+      bool hasMask = i + 1 < argc && isdigit(argv[i+1][0]);
+      uint32_t mask = hasMask ? strtoul(arg, NULL, 0) : ALL_CONNECTORS;
+      report<oduResult>(c, stand.testODU(mask), [](const oduResult &o) {
+        printf("\t0x%X", o.mask);
+        for ( unsigned k=0; k<NUM_CONNECTORS; k++ )
+          if ( o.mask & (1UL << k) )
+            printLEDs(k + 1, o.connectors[k]);
+      });
+      used = hasMask;
+    }
+    else {
+      fprintf(stderr, "Unknown command %s\n", c);
+      return 2;
+    }
+
+    if ( used )
+      i++;
+  }
+
+  while ( outstanding && loop.runOnce() )
+    ;
+
+  fprintf(stderr, "client: %lu lines, %lu bytes in, %lu out, stand busy %lu ms\n",
+          (unsigned long)stand.linesIn, (unsigned long)stand.bytesIn,
+          (unsigned long)stand.bytesOut, (unsigned long)stand.busyMs);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,259 @@
+/*
+ * Turns captured stand output into result store chunks (resultStore.h),
+ * so years of text logs can be queried like the daemon's own store:
+ *
+ *   oduqc_convert [-p serial prefix] [-n stand] -o store.oqr log ...
+ *
+ * A log is either an oduqc_record session (.oqs, both directions) or
+ * text: the stand's lines, long or terse, optionally with the "> " (from
+ * the stand) and "< " (to it) prefixes some capture scripts put on.
+ *
+ * c1/c2 pairs are filed under the connector from the last "12 ODU
+ * connector n" line, or the last "m n" sent to the stand. An ODU ends at
+ * "13 ODU test done", "14 ODU test aborted", an "ODU type" line, or
+ * when a connector comes round again. Normalizations come from any "db"
+ * lines ('N') seen so far. Serials are the prefix and a count (the
+ * log's name and a count of its own by default); times are the log's mtime, less the session
+ * time still to come for .oqs logs.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <sys/stat.h>
+#include <string>
+#include "protocol.h"
+#include "resultStore.h"
+#include "../host/session.h"
+
+struct converter {
+  resultWriter *store;
+  std::string   prefix;
+  unsigned      stand;
+
+  oduChunk      chunk;
+  bool          open;           // chunk has something in it
+  unsigned      odus;
+  unsigned      leds;
+  unsigned      connector;
+  int           ledIndex;
+  uint8_t       type;
+  float         norms[STORE_LEDS];
+  uint64_t      nowMs;          // when the current line was
+  uint64_t      firstMs;        // and the chunk's first
+
+  void begin(uint64_t mtime) {
+    nowMs     = mtime;
+    open      = false;
+    connector = 0;
+    ledIndex  = -1;
+    type      = 0;
+    memset(norms, 0, sizeof(norms));
+    chunkClear(&chunk);
+    return;
+  }
+
+  void flush(uint8_t status) {
+    if ( !open )
+      return;
+    odus++;
+    chunk.startMs    = firstMs;
+    chunk.durationMs = nowMs - firstMs;
+    chunk.stand      = stand;
+    chunk.type       = type;
+    chunk.status     = status;
+    memcpy(chunk.normalization, norms, sizeof(norms));
+    snprintf(chunk.serial, sizeof(chunk.serial), "%s-%u", prefix.c_str(), odus);
+    for ( unsigned k=0; k<NUM_CONNECTORS; k++ )
+      if ( __builtin_popcount(chunk.ledMask[k]) > chunk.leds )
+        chunk.leds = __builtin_popcount(chunk.ledMask[k]);
+    if ( !store->append(&chunk) )
+      perror("convert: result store");
+    chunkClear(&chunk);
+    open = false;
+    return;
+  }
+
+  // Where the head is now. Coming back to one that's done is a new ODU
+  void moveTo(unsigned c) {
+    if ( c < 1 || c > NUM_CONNECTORS )
+      return;
+    if ( open && (chunk.connectorMask & (1UL << (c - 1))) )
+      flush(1);
+    connector = c;
+    return;
+  }
+
+  // A line from the host to the stand
+  void sent(const char *text) {
+    unsigned c;
+    if ( sscanf(text, "m %u", &c) == 1 )
+      moveTo(c);
+    return;
+  }
+
+  // A line from the stand
+  void heard(const char *text) {
+    standLine line;
+    switch ( parseLine(text, &line) ) {
+    case MSG_ODU_TYPE:
+      flush(1);
+      type = argIs(line, "odd") ? 1 : 2;
+      break;
+    case MSG_CONNECTOR:
+      moveTo(line.num[0]);
+      break;
+    case MSG_NORM:
+      if ( line.nargs >= 3 && line.num[0] >= 0 && line.num[0] < STORE_LEDS )
+        norms[line.num[0]] = line.num[1] + line.num[2] / 1000.0f;
+      break;
+    case MSG_LED_START:
+      ledIndex = line.num[1];
+      break;
+    case MSG_LED_DATA: {
+      if ( ledIndex < 0 || !connector )
+        break;
+      ledResult led;
+      led.led = ledIndex;
+      ledFromLine(line, &led);
+      if ( !open )
+        firstMs = nowMs;
+      chunkLED(&chunk, connector, led);
+      open = true;
+      ledIndex = -1;
+      leds++;
+      break;
+    }
+    case MSG_ODU_DONE:
+    case MSG_ODU_ABORTED:
+      flush(line.id == MSG_ODU_DONE ? 1 : 2);
+      connector = 0;                  // it's parked, and a bare 'a' after this is nowhere
+      break;
+    }
+    return;
+  }
+};
+
+static bool convertSession( converter &cv, const char *file, uint64_t mtime ) {
+
+  sessionLog log;
+  if ( !log.load(file) )
+    return false;
+
+  uint32_t last = log.records.empty() ? 0 : log.records.back().t;
+  cv.begin(mtime);
+  for ( size_t i=0; i<log.records.size(); i++ ) {
+    const sessionRecord &rec = log.records[i];
+    cv.nowMs = mtime - (last - rec.t) / 1000;
+    if ( rec.dir == '<' )
+      cv.sent(rec.text.c_str());
+    else
+      cv.heard(rec.text.c_str());
+  }
+  cv.flush(1);
+  return true;
+}
+
+static bool convertText( converter &cv, const char *file, uint64_t mtime ) {
+
+  FILE *in = fopen(file, "r");
+  if ( !in )
+    return false;
+
+  char line[1024];
+  cv.begin(mtime);
+  while ( fgets(line, sizeof(line), in) ) {
+    line[strcspn(line, "\r\n")] = '\0';
+    if ( line[0] == '<' && line[1] == ' ' )
+      cv.sent(line + 2);
+    else if ( line[0] == '>' && line[1] == ' ' )
+      cv.heard(line + 2);
+    else
+      cv.heard(line);
+  }
+  fclose(in);
+  cv.flush(1);
+  return true;
+}
+
+static int usage( const char *name ) {
+  fprintf(stderr, "usage: %s [-p serial prefix] [-n stand] -o store.oqr log ...\n", name);
+  return 2;
+}
+
+int main(int argc, char **argv) {
+
+  const char *out = 0x0, *prefix = 0x0;
+  unsigned stand = 0;
+
+  int opt;
+  while ( (opt = getopt(argc, argv, "o:p:n:")) != -1 ) {
+    switch ( opt ) {
+    case 'o':
+      out = optarg;
+      break;
+    case 'p':
+      prefix = optarg;
+      break;
+    case 'n':
+      stand = strtoul(optarg, NULL, 0);
+      break;
+    default:
+      return usage(argv[0]);
+    }
+  }
+  if ( !out || optind >= argc )
+    return usage(argv[0]);
+
+  resultWriter store;
+  if ( !store.open(out) ) {
+    perror(out);
+    return 2;
+  }
+
+  static converter cv;
+  cv.store = &store;
+  cv.stand  = stand;
+  cv.prefix = prefix ? prefix : "";
+  cv.odus   = 0;
+  cv.leds   = 0;
+
+  uint32_t before = store.count();
+  int bad = 0;
+  for ( int i=optind; i<argc; i++ ) {
+    const char *file = argv[i];
+    struct stat st;
+    char magic[4] = {0};
+    FILE *fp = fopen(file, "rb");
+    if ( !fp || stat(file, &st) ) {
+      perror(file);
+      bad++;
+      if ( fp )
+        fclose(fp);
+      continue;
+    }
+    size_t n = fread(magic, 1, 4, fp);
+    fclose(fp);
+
+    // Without -p each log counts its ODUs from 1 under its own name
+    std::string name(file);
+    if ( !prefix ) {
+      cv.prefix = basename(&name[0]);
+      cv.odus   = 0;
+    }
+
+    uint64_t mtime = st.st_mtime * 1000ULL;
+    bool ok = (n == 4 && !memcmp(magic, SESSION_MAGIC, 4)) ? convertSession(cv, file, mtime)
+                                                          : convertText(cv, file, mtime);
+    if ( !ok ) {
+      fprintf(stderr, "convert: can't read %s\n", file);
+      bad++;
+    }
+  }
+
+  fprintf(stderr, "convert: %u ODUs, %u LEDs into %s (%u chunks)\n", store.count() - before, cv.leds, out,
+          store.count());
+  store.close();
+  return bad ? 1 : 0;
+}
@@ -0,0 +1,415 @@
+/*
+ * One process for every stand on the Pi. Each stand gets a standClient
+ * and its own queue of ODUs, all on one event loop: the work is waiting
+ * on serial lines, and a line takes microseconds to parse, so one
+ * thread keeps up with far more stands than a Pi has USB ports.
+ *
+ *   oduqc_daemon [-o results] [-s store] [-r seconds] [-j n] [-t type] dev ...
+ *   oduqc_daemon -S n [-x speed] [-H oduqc_host] [options]
+ *
+ * ODUs come in on stdin, one per line:
+ *
+ *   odu <stand|*> <serial> <type> [mask]     queue an ODU (* = shortest queue)
+ *   report                                   print the report now
+ *   quit                                     stop taking ODUs
+ *
+ * and the daemon exits once stdin is done and every queue is empty.
+ * -j queues n ODUs of type -t on every stand up front. Every LED goes to
+ * the results file (stdout by default) as it comes in, tab separated:
+ *
+ *   L <serial> <stand> <connector> <led> <nonce> <Lmean> <Lstdev> <Smean> <Sstdev>
+ *   O <serial> <stand> <type> <mask done> <status> <seconds>
+ *
+ * -s also appends each ODU, with the stand's normalizations, to a
+ * result store (resultStore.h) for oduqc_query.
+ *
+ * Every -r seconds (and at the end) stderr gets the aggregate ODUs/hour
+ * and each stand's ODUs, busy percentage and queue.
+ *
+ * -S runs n copies of the simulated stand (oduqc_host -s, -x times real
+ * time) on ptys in /tmp and uses those, for trying it all on one box:
+ *
+ *   ./oduqc_daemon -S 4 -x 200 -j 3 -o results.txt < /dev/null
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+#include <string>
+#include <deque>
+#include <vector>
+#include <memory>
+#include "standClient.h"
+#include "resultStore.h"
+
+static const char *statusName[] = { "pending", "done", "failed", "timeout", "closed" };
+
+struct oduJob {
+  char     serial[32];
+  unsigned type;
+  uint32_t mask;
+};
+
+struct stand {
+  standClient        *client;
+  std::string         device;
+  std::deque<oduJob>  queue;
+  bool                running;
+  unsigned            odus, failed, connectors;
+};
+
+static std::vector<stand> stands;
+static FILE     *results;
+static resultWriter store;
+static bool      storing = false;
+static uint64_t  started;
+static bool      inputDone = false;
+static volatile sig_atomic_t quit = 0;
+
+static void stop(int) {quit = 1;}
+
+static void report(void) {
+
+  double hours = (eventLoop::nowMs() - started) / 3600e3;
+  unsigned total = 0;
+  for ( size_t i=0; i<stands.size(); i++ )
+    total += stands[i].odus;
+
+  fprintf(stderr, "daemon: %.1f s, %u ODUs, %.1f ODUs/hour\n", hours * 3600, total, hours ? total / hours : 0.0);
+  fprintf(stderr, "stand\tdevice\todus\tfailed\tconnectors\tbusy%%\tqueued\n");
+  for ( size_t i=0; i<stands.size(); i++ ) {
+    stand &s = stands[i];
+    fprintf(stderr, "%zu\t%s\t%u\t%u\t%u\t%.1f\t%zu\n", i, s.device.c_str(), s.odus, s.failed, s.connectors,
+            hours ? 100.0 * s.client->busyMs / (hours * 3600e3) : 0.0, s.queue.size() + (s.running ? 1 : 0));
+  }
+  return;
+}
+
+// Start the next ODU on stand <i>, if it's free and has one
+static void next(size_t i) {
+
+  stand &s = stands[i];
+  if ( s.running || s.queue.empty() || !s.client->isOpen() )
+    return;
+
+  oduJob job = s.queue.front();
+  s.queue.pop_front();
+  s.running = true;
+  uint64_t start = eventLoop::nowMs();
+
+  // The store's copy, filled in as it goes. A plain new only promises
+  // 16 byte alignment before C++17, not the 64 an oduChunk asks for
+  std::shared_ptr<oduChunk> chunk;
+  void *mem;
+  if ( storing && !posix_memalign(&mem, alignof(oduChunk), sizeof(oduChunk)) ) {
+    struct timeval now;
+    gettimeofday(&now, 0x0);
+    chunk.reset((oduChunk *)mem, free);
+    chunkClear(chunk.get());
+    chunk->startMs = now.tv_sec * 1000ULL + now.tv_usec / 1000;
+    chunk->stand   = i;
+    chunk->type    = job.type;
+    snprintf(chunk->serial, sizeof(chunk->serial), "%s", job.serial);
+  }
+
+  // The library queues these, each goes as the one before it answers
+  s.client->wake(job.type);
+  s.client->setType(job.type);
+  if ( chunk )
+    s.client->normalizations().then([chunk](const reply<normalizationSet> &r) {
+      for ( unsigned k=0; k<r.get().count; k++ )
+        chunk->normalization[k] = r.get().value[k];
+    });
+  reply<oduResult> odu = s.client->testODU(job.mask, [i, job, chunk](unsigned connector, const sequenceResult &r) {
+    for ( unsigned k=0; k<r.count; k++ ) {
+      const ledResult &l = r.leds[k];
+      fprintf(results, "L\t%s\t%zu\t%u\t%u\t%d\t%.2f\t%.2f\t%.2f\t%.2f\n", job.serial, i, connector,
+              l.led, l.nonce, l.lmean, l.lstdev, l.smean, l.sstdev);
+      if ( chunk )
+        chunkLED(chunk.get(), connector, l);
+    }
+    if ( chunk && r.count > chunk->leds )
+      chunk->leds = r.count;
+    stands[i].connectors++;
+  });
+  reply<bool> parked = s.client->home();
+
+  odu.then([i, job, start, chunk](const reply<oduResult> &r) {
+    fprintf(results, "O\t%s\t%zu\t%u\t0x%X\t%s\t%.1f\n", job.serial, i, job.type, r.get().mask,
+            statusName[r.status()], (eventLoop::nowMs() - start) / 1e3);
+    fflush(results);
+    if ( chunk ) {
+      chunk->durationMs = eventLoop::nowMs() - start;
+      chunk->status     = r.status();
+      if ( !store.append(chunk.get()) )
+        perror("daemon: result store");
+    }
+    stand &s = stands[i];
+    if ( r.ok() )
+      s.odus++;
+    else
+      s.failed++;
+  });
+  parked.then([i](const reply<bool> &) {
+    stands[i].running = false;
+    next(i);
+  });
+  return;
+}
+
+static bool queueODU( const char *where, const char *serial, unsigned type, uint32_t mask ) {
+
+  size_t i;
+  if ( !strcmp(where, "*") ) {
+    i = 0;
+    for ( size_t k=1; k<stands.size(); k++ )
+      if ( stands[k].queue.size() + stands[k].running < stands[i].queue.size() + stands[i].running )
+        i = k;
+  }
+  else {
+    i = strtoul(where, NULL, 0);
+    if ( i >= stands.size() )
+      return false;
+  }
+
+  oduJob job;
+  snprintf(job.serial, sizeof(job.serial), "%s", serial);
+  job.type = type;
+  job.mask = mask ? mask : ALL_CONNECTORS;
+  stands[i].queue.push_back(job);
+  next(i);
+  return true;
+}
+
+// The control lines on stdin
+class control : public pollable {
+
+ public:
+  control(eventLoop &l) : loop(l) {
+    len = 0;
+    fcntl(0, F_SETFL, fcntl(0, F_GETFL) | O_NONBLOCK);
+    // epoll won't take a file (or /dev/null), so that's read in one go
+    if ( !loop.add(0, this) ) {
+      fcntl(0, F_SETFL, fcntl(0, F_GETFL) & ~O_NONBLOCK);
+      readable();
+      inputDone = true;
+    }
+  }
+
+  void readable(void) {
+    ssize_t n;
+    while ( (n = read(0, buf + len, sizeof(buf) - 1 - len)) > 0 ) {
+      len += n;
+      buf[len] = '\0';
+
+      char *start = buf, *nl;
+      while ( (nl = strchr(start, '\n')) ) {
+        *nl = '\0';
+        line(start);
+        start = nl + 1;
+      }
+      len = strlen(start);
+      memmove(buf, start, len + 1);
+      if ( len == sizeof(buf) - 1 )
+        len = 0;
+    }
+    if ( n == 0 )
+      hangup();
+  }
+
+  void hangup(void) {
+    loop.remove(0);
+    inputDone = true;
+  }
+
+  void line( const char *text ) {
+    char cmd[16], where[16], serial[32];
+    unsigned type;
+    unsigned long mask = 0;
+
+    if ( sscanf(text, "%15s", cmd) != 1 )
+      return;
+    if ( !strcmp(cmd, "odu") ) {
+      if ( sscanf(text, "%*s %15s %31s %u %li", where, serial, &type, &mask) < 3 ||
+           !queueODU(where, serial, type, mask) )
+        fprintf(stderr, "daemon: bad ODU \"%s\"\n", text);
+    }
+    else if ( !strcmp(cmd, "report") )
+      report();
+    else if ( !strcmp(cmd, "quit") )
+      hangup();
+    else
+      fprintf(stderr, "daemon: unknown \"%s\"\n", text);
+  }
+
+ private:
+  eventLoop &loop;
+  char       buf[256];
+  size_t     len;
+};
+
+// A simulated stand on a pty at <link>, or 0 if it won't start
+static pid_t simulate( const char *host, const char *link, const char *speed ) {
+
+  unlink(link);
+  pid_t pid = fork();
+  if ( pid == 0 ) {
+    int null = open("/dev/null", O_RDWR);
+    dup2(null, 0);
+    dup2(null, 1);
+    dup2(null, 2);
+    execl(host, host, "-s", "-x", speed, "-p", link, (char *)0x0);
+    _exit(127);
+  }
+
+  // It's ready when the link is there
+  for ( int tries=0; pid > 0 && tries<200; tries++ ) {
+    if ( !access(link, F_OK) )
+      return pid;
+    usleep(10000);
+  }
+  if ( pid > 0 )
+    kill(pid, SIGTERM);
+  return 0;
+}
+
+static int usage( const char *name ) {
+  fprintf(stderr, "usage: %s [-o results] [-s store] [-r seconds] [-j n] [-t type] device ...\n"
+                  "       %s -S n [-x speed] [-H oduqc_host] [options]\n", name, name);
+  return 2;
+}
+
+int main(int argc, char **argv) {
+
+  const char *out = 0x0, *storeFile = 0x0, *host = "./oduqc_host", *speed = "1";
+  unsigned simulated = 0, jobs = 0, type = 1, every = 60;
+
+  int opt;
+  while ( (opt = getopt(argc, argv, "o:s:r:j:t:S:x:H:")) != -1 ) {
+    switch ( opt ) {
+    case 'o':
+      out = optarg;
+      break;
+    case 's':
+      storeFile = optarg;
+      break;
+    case 'r':
+      every = strtoul(optarg, NULL, 0);
+      break;
+    case 'j':
+      jobs = strtoul(optarg, NULL, 0);
+      break;
+    case 't':
+      type = strtoul(optarg, NULL, 0);
+      break;
+    case 'S':
+      simulated = strtoul(optarg, NULL, 0);
+      break;
+    case 'x':
+      speed = optarg;
+      break;
+    case 'H':
+      host = optarg;
+      break;
+    default:
+      return usage(argv[0]);
+    }
+  }
+  if ( optind == argc && !simulated )
+    return usage(argv[0]);
+
+  results = out ? fopen(out, "w") : stdout;
+  if ( !results ) {
+    perror(out);
+    return 2;
+  }
+  if ( storeFile ) {
+    if ( !store.open(storeFile) ) {
+      perror(storeFile);
+      return 2;
+    }
+    storing = true;
+  }
+
+  signal(SIGINT, stop);
+  signal(SIGTERM, stop);
+  signal(SIGPIPE, SIG_IGN);
+
+  eventLoop loop;
+
+  std::vector<std::string> devices(argv + optind, argv + argc);
+  std::vector<pid_t> sims;
+  for ( unsigned i=0; i<simulated; i++ ) {
+    char link[64];
+    snprintf(link, sizeof(link), "/tmp/oduqc.%d.%u", (int)getpid(), i);
+    pid_t pid = simulate(host, link, speed);
+    if ( !pid ) {
+      fprintf(stderr, "daemon: can't start %s for %s\n", host, link);
+      quit = 1;
+      break;
+    }
+    devices.push_back(link);
+    sims.push_back(pid);
+  }
+
+  // A simulator is up already, a real board resets when it's opened
+  stands.resize(devices.size());
+  for ( size_t i=0; i<devices.size(); i++ ) {
+    stand &s = stands[i];
+    bool sim = i >= devices.size() - sims.size();
+    s.client     = new standClient(loop);
+    s.device     = devices[i];
+    s.running    = false;
+    s.odus       = s.failed = s.connectors = 0;
+    if ( !s.client->open(s.device.c_str(), BAUD, sim ? 0 : CLIENT_BOOT) )
+      perror(s.device.c_str());
+    else
+      s.client->onFault = [i](const standLine &line) {fprintf(stderr, "stand %zu: %s\n", i, line.text);};
+  }
+
+  started = eventLoop::nowMs();
+  for ( unsigned j=0; j<jobs; j++ )
+    for ( size_t i=0; i<stands.size(); i++ ) {
+      char serial[32];
+      snprintf(serial, sizeof(serial), "sim%zu-%u", i, j + 1);
+      queueODU(std::to_string(i).c_str(), serial, type, ALL_CONNECTORS);
+    }
+
+  control input(loop);
+  uint64_t lastReport = started;
+  while ( !quit && loop.runOnce(200) ) {
+
+    if ( every && eventLoop::nowMs() - lastReport >= every * 1000ULL ) {
+      report();
+      lastReport = eventLoop::nowMs();
+    }
+
+    // Done when there's no more coming and nothing left to do
+    if ( inputDone ) {
+      bool idle = true;
+      for ( size_t i=0; i<stands.size(); i++ )
+        if ( stands[i].client->isOpen() && (stands[i].running || !stands[i].queue.empty()) )
+          idle = false;
+      if ( idle )
+        break;
+    }
+  }
+
+  report();
+
+  for ( size_t i=0; i<stands.size(); i++ )
+    delete stands[i].client;
+  for ( size_t i=0; i<sims.size(); i++ ) {
+    kill(sims[i], SIGTERM);
+    waitpid(sims[i], 0x0, 0);
+  }
+  if ( results != stdout )
+    fclose(results);
+  store.close();
+  return 0;
+}
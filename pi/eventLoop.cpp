@@ -0,0 +1,122 @@
+#include "eventLoop.h"
+#include <stdio.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+#define MAX_EVENTS 32
+
+eventLoop::eventLoop(void) {
+  epfd   = epoll_create1(EPOLL_CLOEXEC);
+  if ( epfd < 0 )
+    perror("epoll");
+  quit   = false;
+  nextId = 1;
+  return;
+}
+
+eventLoop::~eventLoop(void) {
+  if ( epfd >= 0 )
+    close(epfd);
+  return;
+}
+
+uint64_t eventLoop::nowMs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+}
+
+bool eventLoop::add( int fd, pollable *p ) {
+  struct epoll_event ev;
+  ev.events   = EPOLLIN;
+  ev.data.ptr = p;
+  return !epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+void eventLoop::remove( int fd ) {
+  epoll_ctl(epfd, EPOLL_CTL_DEL, fd, 0x0);
+  return;
+}
+
+// Only ask for EPOLLOUT while there's something waiting to go
+void eventLoop::wantWrite( int fd, pollable *p, bool want ) {
+  struct epoll_event ev;
+  ev.events   = want ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+  ev.data.ptr = p;
+  epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev);
+  return;
+}
+
+eventLoop::timerId eventLoop::after( uint32_t ms, std::function<void(void)> fn ) {
+  timerId id = nextId++;
+  uint64_t when = nowMs() + ms;
+  timers[std::make_pair(when, id)] = fn;
+  due[id] = when;
+  return id;
+}
+
+void eventLoop::cancel( timerId id ) {
+  std::map<timerId, uint64_t>::iterator it = due.find(id);
+  if ( it == due.end() )
+    return;
+  timers.erase(std::make_pair(it->second, id));
+  due.erase(it);
+  return;
+}
+
+// A timer may add or cancel others, so take them one at a time
+void eventLoop::fireTimers(void) {
+  uint64_t now = nowMs();
+  while ( !timers.empty() && timers.begin()->first.first <= now ) {
+    std::function<void(void)> fn;
+    fn.swap(timers.begin()->second);
+    due.erase(timers.begin()->first.second);
+    timers.erase(timers.begin());
+    fn();
+  }
+  return;
+}
+
+bool eventLoop::runOnce( int maxMs ) {
+
+  if ( quit )
+    return false;
+
+  // Sleep no longer than the next timer
+  int wait = maxMs;
+  if ( !timers.empty() ) {
+    uint64_t now = nowMs(), when = timers.begin()->first.first;
+    int untilTimer = (when > now) ? (int)(when - now) : 0;
+    if ( wait < 0 || untilTimer < wait )
+      wait = untilTimer;
+  }
+
+  struct epoll_event ev[MAX_EVENTS];
+  int n = epoll_wait(epfd, ev, MAX_EVENTS, wait);
+  if ( n < 0 && errno != EINTR ) {
+    perror("epoll_wait");
+    quit = true;
+    return false;
+  }
+
+  for ( int i=0; i<n; i++ ) {
+    pollable *p = (pollable *)ev[i].data.ptr;
+    if ( ev[i].events & EPOLLIN )
+      p->readable();
+    if ( ev[i].events & EPOLLOUT )
+      p->writable();
+    if ( ev[i].events & (EPOLLHUP | EPOLLERR) && !(ev[i].events & EPOLLIN) )
+      p->hangup();
+  }
+
+  fireTimers();
+  return !quit;
+}
+
+void eventLoop::run(void) {
+  while ( runOnce() )
+    ;
+  return;
+}
@@ -0,0 +1,61 @@
+#ifndef EVENTLOOP_H
+#define EVENTLOOP_H
+
+#include <stdint.h>
+#include <functional>
+#include <map>
+
+/*
+ * One epoll set and a list of timers, so a single thread can keep any
+ * number of stands (and whatever else has a file descriptor) going
+ * without ever blocking on one of them.
+ */
+
+// Something with a file descriptor for the loop to watch
+class pollable {
+
+ public:
+  virtual ~pollable(void) {}
+
+  virtual void readable(void) = 0;
+  virtual void writable(void) {}
+  virtual void hangup(void) {}
+};
+
+class eventLoop {
+
+ public:
+  typedef uint64_t timerId;
+
+  eventLoop(void);
+  ~eventLoop(void);
+
+  bool    add          ( int fd, pollable *p );
+  void    remove       ( int fd );
+  void    wantWrite    ( int fd, pollable *p, bool want );
+
+  // Run <fn> once, <ms> from now. 0 is never a timer, so it can mean "none"
+  timerId after        ( uint32_t ms, std::function<void(void)> fn );
+  void    cancel       ( timerId id );
+
+  // One epoll_wait (at most <maxMs>, -1 for as long as it takes) and
+  // everything it woke up. False once stop() has been called
+  bool    runOnce      ( int maxMs = -1 );
+  void    run          ( void );
+  void    stop         ( void ) {quit = true;}
+
+  static uint64_t nowMs( void );
+
+ private:
+  void    fireTimers   ( void );
+
+  int     epfd;
+  bool    quit;
+  timerId nextId;
+
+  // Keyed on (due, id) so they come out in order; <due> finds them again
+  std::map<std::pair<uint64_t, timerId>, std::function<void(void)> > timers;
+  std::map<timerId, uint64_t> due;
+};
+
+#endif
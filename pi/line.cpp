@@ -0,0 +1,38 @@
+#include "line.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <asm/termbits.h>
+#include <asm/ioctls.h>
+
+// <sys/ioctl.h> drags in the glibc termios, which fights termbits.h
+extern "C" int ioctl(int, unsigned long, ...);
+
+// termios2, so the rate is just a number
+bool setLine( int fd, uint32_t baud ) {
+  struct termios2 tio;
+  if ( ioctl(fd, TCGETS2, &tio) )
+    return false;
+  tio.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON);
+  tio.c_oflag &= ~OPOST;
+  tio.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+  tio.c_cflag &= ~(CSIZE | PARENB | CBAUD);
+  tio.c_cflag |= CS8 | CLOCAL | CREAD | BOTHER;
+  tio.c_ispeed = tio.c_ospeed = baud;
+  tio.c_cc[VMIN] = 0;
+  tio.c_cc[VTIME] = 0;
+  return !ioctl(fd, TCSETS2, &tio);
+}
+
+int openLine( const char *dev, uint32_t baud ) {
+  int fd = open(dev, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+  if ( fd < 0 )
+    return -1;
+  if ( !setLine(fd, baud) ) {
+    close(fd);
+    return -1;
+  }
+
+  // Anything already waiting was said to someone else
+  ioctl(fd, TCFLSH, TCIFLUSH);
+  return fd;
+}
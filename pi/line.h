@@ -0,0 +1,11 @@
+#ifndef LINE_H
+#define LINE_H
+
+#include <stdint.h>
+
+// The stand's serial port, raw 8N1 and non-blocking, at any rate the
+// firmware takes (250000 and up included). -1 if it can't be had
+int  openLine ( const char *dev, uint32_t baud );
+bool setLine  ( int fd, uint32_t baud );
+
+#endif
@@ -0,0 +1,40 @@
+#include "mapFile.h"
+#include <stdio.h>
+#include <string.h>
+
+bool readMapFile( const char *file, unsigned type, connectorMap *map ) {
+
+  FILE *in = fopen(file, "r");
+  if ( !in ) {
+    perror(file);
+    return false;
+  }
+  builtInMap(type, map);
+
+  char text[128];
+  unsigned line = 0;
+  bool good = true;
+  while ( fgets(text, sizeof(text), in) ) {
+    line++;
+    unsigned c, high;
+    int x, y, z, r;
+    if ( text[0] == '#' || text[strspn(text, " \t\r\n")] == '\0' )
+      continue;
+    if ( sscanf(text, "%u %d %d %d %d %u", &c, &x, &y, &z, &r, &high) != 6 || c < 1 || c > MAP_ENTRIES ) {
+      fprintf(stderr, "%s:%u: want connector x y z r high\n", file, line);
+      good = false;
+      break;
+    }
+    connectorPos &p = map->pos[c - 1];
+    p.x = x;
+    p.y = y;
+    p.z = z;
+    p.r = r;
+    if ( high )
+      map->zFirst |= 1UL << (c - 1);
+    else
+      map->zFirst &= ~(1UL << (c - 1));
+  }
+  fclose(in);
+  return good;
+}
@@ -0,0 +1,15 @@
+#ifndef MAPFILE_H
+#define MAPFILE_H
+
+#include "../connectorMap.h"
+
+/*
+ * Connector maps as text, the way oduqc_client's map prints them: one
+ * "connector x y z r high" line per connector, # for comments. The
+ * connectors a file leaves out keep their places in the built in map.
+ */
+
+// <file> over <type>'s built in map. False and a message if it's bad
+bool readMapFile ( const char *file, unsigned type, connectorMap *map );
+
+#endif
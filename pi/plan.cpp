@@ -0,0 +1,145 @@
+/*
+ * Every move the stand can make, planned exactly as the firmware plans
+ * it (planMove() in connectorMap.h), and checked against the rules the
+ * order of the legs is there to keep:
+ *
+ *   oduqc_plan [-m map -t type] [-t type] [-l]
+ *
+ *   -m file     a map for -t's type (mapFile.h) instead of the built in one
+ *   -t type     only this type, 1 odd or 2 even (both by default)
+ *   -l          list the plans: type, from, to, then axis:target a leg
+ *
+ * A move starts from home or any connector (unplugged), and
+ *
+ *   - every target is inside its axis' travel (config.h)
+ *   - the head is never turned past vertical (r_steps_to_90) below the
+ *     lowest connector it's turned over for, so it can't turn over
+ *     before it's gone up, or come down before it's turned back
+ *   - it ends up where the map says
+ *
+ * Anything that breaks a rule is printed, and it exits 1.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "mapFile.h"
+
+static const char axisName[] = "XYZR";
+static const int  axisLimit[PLAN_LEGS] = { XLimit, YLimit, ZLimit, RLimit };
+
+static unsigned problems = 0;
+
+static void problem( unsigned type, unsigned from, unsigned to, uint8_t axis, const char *what, int value ) {
+  printf("type %u from %u to %u: %c %s %d\n", type, from, to, axisName[axis], what, value);
+  problems++;
+}
+
+// Walk <plan> from <at>, checking each leg as it goes
+static void checkPlan( const connectorMap &map, unsigned type, unsigned from, unsigned to,
+                       connectorPos at, const movePlan &plan, int overZ ) {
+
+  for ( unsigned i=0; i<PLAN_LEGS; i++ ) {
+    const moveLeg &leg = plan.leg[i];
+    int target = leg.target;
+
+    if ( target < 0 || target > axisLimit[leg.axis] )
+      problem(type, from, to, leg.axis, "out of travel at", target);
+
+    if ( leg.axis == PLAN_R && (at.r > r_steps_to_90 || target > r_steps_to_90) && at.z < overZ )
+      problem(type, from, to, PLAN_R, "turns past vertical with Z at", at.z);
+    if ( leg.axis == PLAN_Z && at.r > r_steps_to_90 && target < overZ )
+      problem(type, from, to, PLAN_Z, "comes down turned over to", target);
+
+    switch ( leg.axis ) {
+    case PLAN_X: at.x = target; break;
+    case PLAN_Y: at.y = target; break;
+    case PLAN_Z: at.z = target; break;
+    case PLAN_R: at.r = target; break;
+    }
+  }
+
+  const connectorPos &want = map.pos[to-1];
+  for ( unsigned a=0; a<PLAN_LEGS; a++ )
+    if ( axisTarget(at, a) != axisTarget(want, a) )
+      problem(type, from, to, a, "ends at", axisTarget(at, a));
+}
+
+static unsigned planType( const connectorMap &map, unsigned type, bool list ) {
+
+  // The lowest the head goes turned over, by the map's own connectors
+  int overZ = ZLimit + 1;
+  for ( unsigned c=0; c<MAP_ENTRIES; c++ )
+    if ( map.pos[c].r > r_steps_to_90 && map.pos[c].z < overZ )
+      overZ = map.pos[c].z;
+
+  unsigned plans = 0;
+  for ( unsigned from=0; from<=MAP_ENTRIES; from++ ) {
+    connectorPos at = { 0, 0, 0, 0 };
+    if ( from )
+      at = map.pos[from-1];
+
+    for ( unsigned to=1; to<=MAP_ENTRIES; to++ ) {
+      movePlan plan;
+      planMove(map, to, &plan);
+      checkPlan(map, type, from, to, at, plan, overZ);
+      plans++;
+
+      if ( !list )
+        continue;
+      printf("%u\t%u\t%u", type, from, to);
+      for ( unsigned i=0; i<PLAN_LEGS; i++ )
+        printf("\t%c:%d", axisName[plan.leg[i].axis], plan.leg[i].target);
+      printf("\n");
+    }
+  }
+  return plans;
+}
+
+static int usage( const char *name ) {
+  fprintf(stderr, "usage: %s [-m map -t type] [-t type] [-l]\n", name);
+  return 2;
+}
+
+int main(int argc, char **argv) {
+
+  const char *mapFile = 0x0;
+  unsigned only = 0;
+  bool list = false;
+
+  int opt;
+  while ( (opt = getopt(argc, argv, "m:t:l")) != -1 ) {
+    switch ( opt ) {
+    case 'm':
+      mapFile = optarg;
+      break;
+    case 't':
+      only = (atoi(optarg) % 2) ? 1 : 2;
+      break;
+    case 'l':
+      list = true;
+      break;
+    default:
+      return usage(argv[0]);
+    }
+  }
+  if ( optind != argc || (mapFile && !only) )
+    return usage(argv[0]);
+
+  unsigned plans = 0;
+  for ( unsigned type=1; type<=2; type++ ) {
+    if ( only && type != only )
+      continue;
+
+    connectorMap map;
+    if ( mapFile ) {
+      if ( !readMapFile(mapFile, type, &map) )
+        return 2;
+    }
+    else
+      builtInMap(type, &map);
+    plans += planType(map, type, list);
+  }
+
+  fprintf(stderr, "plan: %u moves, %u problems\n", plans, problems);
+  return problems ? 1 : 0;
+}
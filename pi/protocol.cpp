@@ -0,0 +1,196 @@
+#include "protocol.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct entry {
+  const char *key;
+  bool        bare;
+  const char *format;
+};
+
+#define MSG(name, key, bare, format) { key, bare, format },
+static const entry table[MESSAGES] = {
+  MESSAGE_TABLE
+};
+#undef MSG
+
+// One number for conversion <conv> at <p>, or null if there isn't one.
+// No leading spaces: the formats say exactly where those go
+static const char *number( const char *p, char conv, standLine *out ) {
+
+  if ( out->nargs >= LINE_ARGS || !*p || *p == ' ' )
+    return 0x0;
+
+  char *end = (char *)p;
+  switch ( conv ) {
+  case 'i':
+    out->num[out->nargs++] = strtol(p, &end, 10);
+    break;
+  case 'u':
+    out->num[out->nargs++] = strtoul(p, &end, 10);
+    break;
+  case 'x':
+    out->num[out->nargs++] = strtoul(p, &end, 16);
+    break;
+  case 'c':
+    out->num[out->nargs++] = *p;
+    end++;
+    break;
+  case 'f':
+    out->real = strtod(p, &end);
+    out->num[out->nargs++] = (long)out->real;
+    break;
+  default:
+    return 0x0;
+  }
+
+  return (end == p) ? 0x0 : end;
+}
+
+// The conversion at <f> (just past the %), and where the format goes on
+static char conversion( const char *&f ) {
+  if ( *f == 'l' )
+    f++;
+  return *f ? *f++ : '\0';
+}
+
+// "<key> <arg> <arg> ...", <p> just past the key
+static bool matchTerse( const char *p, const char *format, standLine *out ) {
+
+  for ( const char *f=format; *f; ) {
+    if ( *f++ != '%' )
+      continue;
+    if ( *p++ != ' ' )
+      return false;
+
+    char conv = conversion(f);
+    if ( conv == 's' ) {
+      out->str = p;
+      while ( *p && *p != ' ' )
+        p++;
+      out->strLen = p - out->str;
+      if ( !out->strLen )
+        return false;
+    }
+    else if ( !(p = number(p, conv, out)) )
+      return false;
+  }
+
+  return !*p;
+}
+
+// The format itself, with the arguments where its conversions are
+static bool matchVerbose( const char *p, const char *format, standLine *out ) {
+
+  for ( const char *f=format; *f; ) {
+    if ( *f != '%' ) {
+      if ( *p++ != *f++ )
+        return false;
+      continue;
+    }
+    f++;
+
+    char conv = conversion(f);
+    if ( conv == 's' ) {
+      // Up to whatever the format has next
+      out->str = p;
+      while ( *p && *p != *f )
+        p++;
+      out->strLen = p - out->str;
+    }
+    else if ( !(p = number(p, conv, out)) )
+      return false;
+  }
+
+  return !*p;
+}
+
+static void clear( standLine *out ) {
+  out->nargs  = 0;
+  out->real   = 0.0;
+  out->str    = 0x0;
+  out->strLen = 0;
+}
+
+/*
+ * Which message is <text>? Terse lines are the key and the arguments,
+ * so they're tried first: a long line never has the right number of
+ * words to pass for one.
+ */
+int parseLine( const char *text, standLine *out ) {
+
+  out->text = text;
+  out->id   = LINE_OTHER;
+  clear(out);
+
+  if ( text[0] == 't' && text[1] == '1' && text[2] == ' ' ) {
+    out->id = LINE_TELEMETRY;
+    return out->id;
+  }
+
+  for ( int i=0; i<MESSAGES; i++ ) {
+    size_t len = strlen(table[i].key);
+    if ( strncmp(text, table[i].key, len) || (text[len] && text[len] != ' ') )
+      continue;
+    if ( matchTerse(text + len, table[i].format, out) )
+      return out->id = i;
+    clear(out);
+  }
+
+  for ( int i=0; i<MESSAGES; i++ ) {
+    const char *p = text;
+    if ( !table[i].bare ) {
+      if ( p[0] != table[i].key[0] || p[1] != table[i].key[1] || p[2] != ' ' )
+        continue;
+      p += 3;
+    }
+    if ( matchVerbose(p, table[i].format, out) )
+      return out->id = i;
+    clear(out);
+  }
+
+  return out->id;
+}
+
+bool parseTelemetry( const char *text, telemetryFrame *out ) {
+
+  if ( strncmp(text, "t1 ", 3) )
+    return false;
+
+  long v[8];
+  char *p = (char *)text + 3, *end;
+  for ( int i=0; i<8; i++ ) {
+    v[i] = strtol(p, &end, 10);
+    if ( end == p || *end != ' ' )
+      return false;
+    p = end + 1;
+  }
+  if ( !*p )
+    return false;
+
+  out->millis = v[0];
+  out->x      = v[1];
+  out->y      = v[2];
+  out->z      = v[3];
+  out->r      = v[4];
+  out->limits = v[5];
+  out->light  = v[6];
+  out->flags  = v[7];
+  out->op     = *p;
+  return true;
+}
+
+// c2 <nonce> <L> <L/100> <Ls> <Ls/100> <S> <S/100> <Ss> <Ss/100>
+void ledFromLine( const standLine &line, ledResult *out ) {
+  const long *n = line.num;
+  out->nonce  = n[0];
+  out->lmean  = n[1] + n[2] / 100.0f;
+  out->lstdev = n[3] + n[4] / 100.0f;
+  out->smean  = n[5] + n[6] / 100.0f;
+  out->sstdev = n[7] + n[8] / 100.0f;
+  return;
+}
+
+bool argIs( const standLine &line, const char *word ) {
+  return line.str && (int)strlen(word) == line.strLen && !strncmp(line.str, word, line.strLen);
+}
@@ -0,0 +1,58 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <stdint.h>
+
+#define MESSAGES_TABLE_ONLY
+#include "../messages.h"
+
+/*
+ * The stand's lines, taken apart in place. Every message in the
+ * firmware's table (messages.h) is recognised whether the stand is
+ * terse or not, and its arguments come out as numbers, so nothing
+ * downstream ever looks at the text again. Nothing here allocates.
+ */
+
+#define LINE_ARGS      9            // c2 has the most
+#define LINE_TELEMETRY MESSAGES     // t1 frames, not in the table
+#define LINE_OTHER     -1           // traces, echoes, anything else
+
+struct standLine {
+  int          id;                  // messageId, LINE_TELEMETRY or LINE_OTHER
+  int          nargs;
+  long         num[LINE_ARGS];      // %i %u %x %c, in order
+  double       real;                // the %f, if there is one
+  const char  *str;                 // the %s, if there is one (not terminated)
+  int          strLen;
+  const char  *text;                // the whole line, without its \r\n
+};
+
+// One LED from a c1/c2 pair. The stand sends hundredths, so that's
+// all the floats carry
+struct ledResult {
+  uint8_t  led;
+  int16_t  nonce;                   // the c2's
+  float    lmean, lstdev;           // large diode, normalized on the stand
+  float    smean, sstdev;           // small diode
+};
+
+// t1 <millis> <x> <y> <z> <r> <limits> <light> <flags> <op>
+struct telemetryFrame {
+  uint32_t millis;
+  int16_t  x, y, z, r;
+  uint8_t  limits;                  // X=1 Y=2 Z=4 R=8
+  uint16_t light;
+  uint8_t  flags;                   // CRASH_STOP=1 FATAL_ERROR=2
+  char     op;
+};
+
+int  parseLine      ( const char *text, standLine *out );
+bool parseTelemetry ( const char *text, telemetryFrame *out );
+
+// The numbers of a c2 line into <out> (led is left alone)
+void ledFromLine    ( const standLine &line, ledResult *out );
+
+// Is <line> the %s <word>? ("on", "odd", ...)
+bool argIs          ( const standLine &line, const char *word );
+
+#endif
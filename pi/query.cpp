@@ -0,0 +1,208 @@
+/*
+ * Questions over a result store (resultStore.h). The store is mapped,
+ * each ODU's index entry picks it or not, and only the columns asked for
+ * are read, so months of QC come back in milliseconds:
+ *
+ *   oduqc_query [filters] [-i | -r] store.oqr ...
+ *
+ *   -c n        connector n only (1-18)
+ *   -l n        LED n only
+ *   -t n        ODU type n only
+ *   -n n        stand n only
+ *   -s text     serials starting with text
+ *   -a when     ODUs started at or after when
+ *   -b when     and before when (unix seconds or YYYY-MM-DD[THH:MM[:SS]])
+ *   -F          failed and aborted ODUs too
+ *
+ * By default it prints, per connector and LED, how many measurements
+ * there were and the mean, standard deviation, minimum and maximum of
+ * Lmean, with the mean Smean. -i lists the ODUs instead, -r every LED
+ * row in the daemon's "L" layout. How long the scan took goes to stderr.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include "resultStore.h"
+
+struct filter {
+  int         connector, led, type, stand;
+  const char *serial;
+  size_t      serialLen;
+  uint64_t    after, before;       // unix ms
+  bool        failed;
+};
+
+struct tally {
+  uint32_t n;
+  double   sum, sumSq, min, max;
+  double   smean;
+};
+
+static uint64_t usNow(void) {
+  struct timeval tv;
+  gettimeofday(&tv, 0x0);
+  return tv.tv_sec * 1000000ULL + tv.tv_usec;
+}
+
+static bool wanted( const filter &f, const oduChunk *c ) {
+  if ( !c )
+    return false;
+  if ( !f.failed && c->status != 1 )                // REPLY_DONE
+    return false;
+  if ( (f.type >= 0 && c->type != f.type) || (f.stand >= 0 && c->stand != f.stand) )
+    return false;
+  if ( c->startMs < f.after || (f.before && c->startMs >= f.before) )
+    return false;
+  if ( f.connector > 0 && !(c->connectorMask & (1UL << (f.connector - 1))) )
+    return false;
+  if ( f.serial && strncmp(c->serial, f.serial, f.serialLen) )
+    return false;
+  return true;
+}
+
+static int usage( const char *name ) {
+  fprintf(stderr, "usage: %s [-c connector] [-l led] [-t type] [-n stand] [-s serial] [-a when] [-b when] [-F]\n"
+                  "       [-i | -r] store.oqr ...\n", name);
+  return 2;
+}
+
+int main(int argc, char **argv) {
+
+  filter f;
+  memset(&f, 0, sizeof(f));
+  f.connector = f.led = f.type = f.stand = -1;
+  char mode = 'a';
+
+  int opt;
+  while ( (opt = getopt(argc, argv, "c:l:t:n:s:a:b:Fir")) != -1 ) {
+    switch ( opt ) {
+    case 'c':
+      f.connector = atoi(optarg);
+      break;
+    case 'l':
+      f.led = atoi(optarg);
+      break;
+    case 't':
+      f.type = atoi(optarg);
+      break;
+    case 'n':
+      f.stand = atoi(optarg);
+      break;
+    case 's':
+      f.serial    = optarg;
+      f.serialLen = strlen(optarg);
+      break;
+    case 'a':
+    case 'b':
+      if ( !(opt == 'a' ? (f.after = storeTime(optarg)) : (f.before = storeTime(optarg))) ) {
+        fprintf(stderr, "query: can't read the time \"%s\"\n", optarg);
+        return 2;
+      }
+      break;
+    case 'F':
+      f.failed = true;
+      break;
+    case 'i':
+    case 'r':
+      mode = opt;
+      break;
+    default:
+      return usage(argv[0]);
+    }
+  }
+  if ( optind >= argc )
+    return usage(argv[0]);
+
+  static tally t[NUM_CONNECTORS][STORE_LEDS];
+  for ( unsigned k=0; k<NUM_CONNECTORS; k++ )
+    for ( unsigned i=0; i<STORE_LEDS; i++ ) {
+      t[k][i].min = INFINITY;
+      t[k][i].max = -INFINITY;
+    }
+
+  unsigned kFrom = (f.connector > 0) ? f.connector - 1 : 0;
+  unsigned kTo   = (f.connector > 0) ? f.connector     : NUM_CONNECTORS;
+  uint32_t only  = (f.led >= 0 && f.led < STORE_LEDS) ? 1UL << f.led : 0xFFFFFFFFUL;
+
+  if ( mode == 'i' )
+    printf("serial\tstand\ttype\tstarted\tseconds\tconnectors\tstatus\n");
+  else if ( mode == 'r' )
+    printf("serial\tstand\tconnector\tled\tnonce\tLmean\tLstdev\tSmean\tSstdev\tnorm\n");
+
+  uint64_t began = usNow();
+  size_t chunks = 0, odus = 0, rows = 0;
+  for ( int a=optind; a<argc; a++ ) {
+
+    resultReader store;
+    if ( !store.open(argv[a]) ) {
+      perror(argv[a]);
+      continue;
+    }
+    chunks += store.count();
+
+    for ( size_t n=0; n<store.count(); n++ ) {
+      const oduChunk *c = store.chunk(n);
+      if ( !wanted(f, c) )
+        continue;
+      odus++;
+
+      if ( mode == 'i' ) {
+        char when[32];
+        time_t secs = c->startMs / 1000;
+        strftime(when, sizeof(when), "%Y-%m-%dT%H:%M:%S", localtime(&secs));
+        printf("%.32s\t%u\t%u\t%s\t%.1f\t0x%X\t%u\n", c->serial, c->stand, c->type, when,
+               c->durationMs / 1e3, c->connectorMask, c->status);
+        continue;
+      }
+
+      for ( unsigned k=kFrom; k<kTo; k++ ) {
+        uint32_t leds = c->ledMask[k] & only;
+        while ( leds ) {
+          unsigned i = __builtin_ctz(leds);
+          leds &= leds - 1;
+          rows++;
+
+          if ( mode == 'r' ) {
+            printf("%.32s\t%u\t%u\t%u\t%d\t%.2f\t%.2f\t%.2f\t%.2f\t%.3f\n", c->serial, c->stand, k + 1, i,
+                   c->nonce[k][i], c->lmean[k][i], c->lstdev[k][i], c->smean[k][i], c->sstdev[k][i],
+                   c->normalization[i]);
+            continue;
+          }
+
+          tally &s = t[k][i];
+          double v = c->lmean[k][i];
+          s.n++;
+          s.sum   += v;
+          s.sumSq += v * v;
+          s.smean += c->smean[k][i];
+          if ( v < s.min )
+            s.min = v;
+          if ( v > s.max )
+            s.max = v;
+        }
+      }
+    }
+  }
+  uint64_t took = usNow() - began;
+
+  if ( mode == 'a' ) {
+    printf("connector\tled\tn\tLmean\tLstdev\tLmin\tLmax\tSmean\n");
+    for ( unsigned k=0; k<NUM_CONNECTORS; k++ )
+      for ( unsigned i=0; i<STORE_LEDS; i++ ) {
+        const tally &s = t[k][i];
+        if ( !s.n )
+          continue;
+        double mean = s.sum / s.n;
+        double var  = (s.n > 1) ? (s.sumSq - s.n * mean * mean) / (s.n - 1) : 0;
+        printf("%u\t%u\t%u\t%.2f\t%.2f\t%.2f\t%.2f\t%.2f\n", k + 1, i, s.n, mean, var > 0 ? sqrt(var) : 0.0,
+               s.min, s.max, s.smean / s.n);
+      }
+  }
+
+  fprintf(stderr, "query: %zu of %zu ODUs, %zu LEDs in %.3f ms\n", odus, chunks, rows, took / 1e3);
+  return 0;
+}
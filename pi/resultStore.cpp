@@ -0,0 +1,216 @@
+#include "resultStore.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static_assert(sizeof(storeHeader) == 64, "the store header is 64 bytes");
+static_assert(offsetof(oduChunk, normalization) == 64, "a chunk's index entry is 64 bytes");
+
+void chunkClear( oduChunk *c ) {
+  memset(c, 0, sizeof(*c));
+  return;
+}
+
+void chunkLED( oduChunk *c, unsigned connector, const ledResult &led ) {
+  if ( connector < 1 || connector > NUM_CONNECTORS || led.led >= STORE_LEDS )
+    return;
+  unsigned k = connector - 1, i = led.led;
+  c->connectorMask |= 1UL << k;
+  c->ledMask[k]    |= 1UL << i;
+  c->nonce[k][i]    = led.nonce;
+  c->lmean[k][i]    = led.lmean;
+  c->lstdev[k][i]   = led.lstdev;
+  c->smean[k][i]    = led.smean;
+  c->sstdev[k][i]   = led.sstdev;
+  return;
+}
+
+bool chunkHasLED( const oduChunk *c, unsigned connector, unsigned led ) {
+  if ( connector < 1 || connector > NUM_CONNECTORS || led >= STORE_LEDS )
+    return false;
+  return c->ledMask[connector-1] & (1UL << led);
+}
+
+uint64_t storeTime( const char *text ) {
+  char *end;
+  unsigned long long secs = strtoull(text, &end, 10);
+  if ( end != text && !*end )
+    return secs * 1000;
+
+  struct tm tm;
+  const char *formats[] = { "%Y-%m-%dT%H:%M:%S", "%Y-%m-%dT%H:%M", "%Y-%m-%d" };
+  for ( unsigned i=0; i<sizeof(formats)/sizeof(formats[0]); i++ ) {
+    memset(&tm, 0, sizeof(tm));
+    const char *rest = strptime(text, formats[i], &tm);
+    if ( rest && !*rest ) {
+      tm.tm_isdst = -1;
+      return mktime(&tm) * 1000ULL;
+    }
+  }
+  return 0;
+}
+
+/***********************************************************************************************/
+
+resultWriter::resultWriter(void) {
+  fd     = -1;
+  chunks = 0;
+  return;
+}
+
+resultWriter::~resultWriter(void) {
+  close();
+  return;
+}
+
+// A new file gets a header, an old one has to have ours
+bool resultWriter::open( const char *file ) {
+
+  fd = ::open(file, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if ( fd < 0 )
+    return false;
+
+  storeHeader h;
+  ssize_t n = pread(fd, &h, sizeof(h), 0);
+  if ( n == 0 ) {
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, STORE_MAGIC, 4);
+    h.version    = STORE_VERSION;
+    h.headerSize = sizeof(storeHeader);
+    h.chunkSize  = STORE_CHUNK;
+    h.connectors = NUM_CONNECTORS;
+    h.leds       = STORE_LEDS;
+    if ( pwrite(fd, &h, sizeof(h), 0) != sizeof(h) ) {
+      close();
+      return false;
+    }
+  }
+  else if ( n != sizeof(h) || memcmp(h.magic, STORE_MAGIC, 4) || h.version != STORE_VERSION ||
+            h.chunkSize != STORE_CHUNK ) {
+    fprintf(stderr, "%s isn't a version %d result store\n", file, STORE_VERSION);
+    close();
+    return false;
+  }
+
+  // A torn chunk at the end (the writer died) gets written over
+  struct stat st;
+  fstat(fd, &st);
+  chunks = (st.st_size - sizeof(storeHeader)) / STORE_CHUNK;
+  while ( chunks ) {
+    uint32_t seal;
+    if ( pread(fd, &seal, sizeof(seal), sizeof(storeHeader) + (chunks - 1) * STORE_CHUNK) == sizeof(seal) &&
+         seal == CHUNK_SEALED )
+      break;
+    chunks--;
+  }
+  return true;
+}
+
+bool resultWriter::append( oduChunk *c ) {
+
+  if ( fd < 0 )
+    return false;
+
+  off_t at = sizeof(storeHeader) + (off_t)chunks * STORE_CHUNK;
+  c->seal     = 0;
+  c->sequence = chunks;
+  if ( pwrite(fd, c, STORE_CHUNK, at) != (ssize_t)STORE_CHUNK )
+    return false;
+
+  // Only now is it there for the readers
+  uint32_t seal = CHUNK_SEALED;
+  if ( pwrite(fd, &seal, sizeof(seal), at) != sizeof(seal) )
+    return false;
+  c->seal = seal;
+  chunks++;
+  return true;
+}
+
+void resultWriter::close(void) {
+  if ( fd >= 0 )
+    ::close(fd);
+  fd = -1;
+  return;
+}
+
+/***********************************************************************************************/
+
+resultReader::resultReader(void) {
+  fd     = -1;
+  map    = 0x0;
+  mapped = 0;
+  chunks = 0;
+  return;
+}
+
+resultReader::~resultReader(void) {
+  close();
+  return;
+}
+
+bool resultReader::open( const char *file ) {
+
+  close();
+  fd = ::open(file, O_RDONLY | O_CLOEXEC);
+  if ( fd < 0 )
+    return false;
+
+  storeHeader h;
+  if ( pread(fd, &h, sizeof(h), 0) != sizeof(h) || memcmp(h.magic, STORE_MAGIC, 4) ||
+       h.version != STORE_VERSION || h.chunkSize != STORE_CHUNK ) {
+    fprintf(stderr, "%s isn't a version %d result store\n", file, STORE_VERSION);
+    close();
+    return false;
+  }
+  return refresh();
+}
+
+bool resultReader::refresh(void) {
+
+  struct stat st;
+  if ( fd < 0 || fstat(fd, &st) )
+    return false;
+  if ( (size_t)st.st_size == mapped )
+    return true;
+
+  if ( map )
+    munmap((void *)map, mapped);
+  map    = 0x0;
+  mapped = 0;
+  chunks = 0;
+
+  void *m = mmap(0x0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  if ( m == MAP_FAILED )
+    return false;
+  map    = (const uint8_t *)m;
+  mapped = st.st_size;
+  chunks = (mapped - sizeof(storeHeader)) / STORE_CHUNK;
+
+  // A query walks the whole thing front to back
+  madvise(m, mapped, MADV_SEQUENTIAL);
+  return true;
+}
+
+void resultReader::close(void) {
+  if ( map )
+    munmap((void *)map, mapped);
+  if ( fd >= 0 )
+    ::close(fd);
+  fd     = -1;
+  map    = 0x0;
+  mapped = 0;
+  chunks = 0;
+  return;
+}
+
+const oduChunk *resultReader::chunk( size_t i ) const {
+  if ( i >= chunks )
+    return 0x0;
+  const oduChunk *c = (const oduChunk *)(map + sizeof(storeHeader) + i * STORE_CHUNK);
+  return (c->seal == CHUNK_SEALED) ? c : 0x0;
+}
@@ -0,0 +1,112 @@
+#ifndef RESULTSTORE_H
+#define RESULTSTORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "protocol.h"
+#include "../config.h"
+
+/*
+ * Photodiode results, one fixed size chunk per ODU, appended to a file
+ * readers mmap. A chunk is column major inside: every connector/LED
+ * slot has a place in each column whether it was measured or not, so
+ * "LED 5 on connector 3" is the same offset in every chunk and a query
+ * over a year of ODUs is a strided walk through the mapping.
+ *
+ *   storeHeader          64 bytes, once
+ *   oduChunk             STORE_CHUNK bytes, per ODU
+ *
+ * The first 64 bytes of a chunk are its index entry (serial, time,
+ * stand, type, connectors), so a query can pick ODUs without touching
+ * their columns. A chunk is written with its seal clear, then sealed,
+ * so a reader never sees half an ODU: unsealed chunks don't count.
+ */
+
+#define STORE_MAGIC     "OQR1"
+#define STORE_VERSION   1
+#define STORE_LEDS      18
+#define CHUNK_SEALED    0x4F445553UL   // "SUDO" little endian, anything but 0
+
+struct storeHeader {
+  char     magic[4];
+  uint32_t version;
+  uint32_t headerSize;
+  uint32_t chunkSize;
+  uint16_t connectors;
+  uint16_t leds;
+  uint8_t  reserved[44];
+};
+
+struct alignas(64) oduChunk {
+
+  // The index entry
+  uint32_t seal;
+  uint32_t sequence;                      // its place in the file
+  uint64_t startMs;                       // unix time
+  uint32_t durationMs;
+  uint32_t connectorMask;                 // connectors with data, bit 0 == connector 1
+  uint16_t stand;
+  uint8_t  type;                          // ODU type 1-4
+  uint8_t  status;                        // the replyStatus it finished with
+  uint16_t leds;                          // LEDs per connector on the stand
+  uint16_t reserved;
+  char     serial[32];
+
+  // The columns
+  float    normalization[STORE_LEDS];     // what the stand multiplied Lmean by, 0 if not known
+  uint32_t ledMask[NUM_CONNECTORS];       // LEDs that came back, per connector
+  int16_t  nonce[NUM_CONNECTORS][STORE_LEDS];
+  float    lmean[NUM_CONNECTORS][STORE_LEDS];
+  float    lstdev[NUM_CONNECTORS][STORE_LEDS];
+  float    smean[NUM_CONNECTORS][STORE_LEDS];
+  float    sstdev[NUM_CONNECTORS][STORE_LEDS];
+};
+
+#define STORE_CHUNK     sizeof(oduChunk)
+
+void chunkClear  ( oduChunk *c );
+void chunkLED    ( oduChunk *c, unsigned connector, const ledResult &led );
+bool chunkHasLED ( const oduChunk *c, unsigned connector, unsigned led );
+
+// Unix seconds, or a local YYYY-MM-DD[THH:MM[:SS]], into ms. 0 if it's neither
+uint64_t storeTime ( const char *text );
+
+// Appends. One writer per file
+class resultWriter {
+
+ public:
+  resultWriter(void);
+  ~resultWriter(void);
+
+  bool     open     ( const char *file );
+  bool     append   ( oduChunk *c );      // numbers and seals <c>
+  void     close    ( void );
+  uint32_t count    ( void ) const {return chunks;}
+
+ private:
+  int      fd;
+  uint32_t chunks;
+};
+
+// Reads through a read only mapping, any number at once
+class resultReader {
+
+ public:
+  resultReader(void);
+  ~resultReader(void);
+
+  bool            open    ( const char *file );
+  bool            refresh ( void );       // pick up what's been appended since
+  void            close   ( void );
+
+  size_t          count   ( void ) const {return chunks;}
+  const oduChunk *chunk   ( size_t i ) const;   // null if unsealed
+
+ private:
+  int             fd;
+  const uint8_t  *map;
+  size_t          mapped;
+  size_t          chunks;
+};
+
+#endif
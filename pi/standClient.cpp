@@ -0,0 +1,860 @@
+#include "standClient.h"
+#include "line.h"
+#include "../host/util/crc16.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+// How each kind of answer goes into its reply
+static void takeTrue( replyCore *c, const standLine & ) {
+  static_cast<replyState<bool> *>(c)->value = true;
+}
+static void takeNumber( replyCore *c, const standLine &line ) {
+  static_cast<replyState<unsigned> *>(c)->value = line.nargs ? line.num[0] : 0;
+}
+static void takeOn( replyCore *c, const standLine &line ) {
+  static_cast<replyState<bool> *>(c)->value = argIs(line, "on");
+}
+static void takeType( replyCore *c, const standLine &line ) {
+  static_cast<replyState<unsigned> *>(c)->value = argIs(line, "odd") ? 1 : 2;
+}
+static void takeHead( replyCore *c, const standLine &line ) {
+  const long *n = line.num;
+  headPosition &h = static_cast<replyState<headPosition> *>(c)->value;
+  h.x = n[0] + n[1] / 100.0f;
+  h.y = n[2] + n[3] / 100.0f;
+  h.z = n[4] + n[5] / 100.0f;
+  h.r = n[6] + n[7] / 100.0f;
+}
+static void takeDrift( replyCore *c, const standLine &line ) {
+  driftReport &d = static_cast<replyState<driftReport> *>(c)->value;
+  for ( int i=0; i<4 && 2*i+1 < line.nargs; i++ ) {
+    d.corrections[i] = line.num[2*i];
+    d.last[i]        = line.num[2*i+1];
+  }
+}
+static void takeSpeeds( replyCore *c, const standLine &line ) {
+  axisSpeeds &a = static_cast<replyState<axisSpeeds> *>(c)->value;
+  for ( int i=0; i<4 && i < line.nargs; i++ )
+    a.rpm[i] = line.num[i];
+}
+// "2e X set to 17 rpm slot 0"
+static void takeTuned( replyCore *c, const standLine &line ) {
+  if ( line.id == MSG_TUNED && line.nargs >= 2 )
+    static_cast<replyState<unsigned> *>(c)->value = line.num[1];
+}
+// "db normalization[i] = a.c", c in thousandths
+static void takeNorm( replyCore *c, const standLine &line ) {
+  normalizationSet &s = static_cast<replyState<normalizationSet> *>(c)->value;
+  long i = line.num[0];
+  if ( line.nargs < 3 || i < 0 || i >= MAX_LEDS )
+    return;
+  s.value[i] = line.num[1] + line.num[2] / 1000.0f;
+  if ( i >= s.count )
+    s.count = i + 1;
+}
+
+// "24 Map t connector c x y z r high" a line, then "25 Map t crc slot sequence"
+static void takeMap( replyCore *c, const standLine &line ) {
+  mapReading &m = static_cast<replyState<mapReading> *>(c)->value;
+  const long *n = line.num;
+  if ( line.id == MSG_MAP ) {
+    m.type     = n[0];
+    m.crc      = n[1];
+    m.slot     = n[2];
+    m.sequence = n[3];
+    return;
+  }
+  if ( line.nargs < 7 || n[1] < 1 || n[1] > MAP_ENTRIES )
+    return;
+  connectorPos &p = m.map.pos[n[1] - 1];
+  p.x = n[2];
+  p.y = n[3];
+  p.z = n[4];
+  p.r = n[5];
+  if ( n[6] )
+    m.map.zFirst |= 1UL << (n[1] - 1);
+  m.count++;
+}
+static void takeSaved( replyCore *c, const standLine &line ) {
+  static_cast<replyState<bool> *>(c)->value = (line.id == MSG_MAP_SAVED);
+}
+
+// Is <id> one of the stand's 'f' codes?
+static bool isFault( int id ) {
+  switch ( id ) {
+  case MSG_NO_PORT:      case MSG_BAD_BAUD:      case MSG_BAUD_FALLBACK: case MSG_ODU_ABORTED:
+  case MSG_PANIC:        case MSG_LIGHT_LEAK:    case MSG_LED_ABORTED:   case MSG_LEAK_CLEARED:
+  case MSG_CRASH_CLEARED: case MSG_FATAL_CLEARED: case MSG_UNCALIBRATED: case MSG_NO_SHIELD:
+  case MSG_MOTOR_FAILED: case MSG_CAL_CORRUPT:   case MSG_CAL_LEGACY:    case MSG_CAL_NOT_SAVED:
+  case MSG_MAP_REJECTED: case MSG_DARK_HIGH:     case MSG_TUNE_FAILED:
+    return true;
+  }
+  return false;
+}
+
+standClient::request::request(void) {
+  text[0]   = '\0';
+  kind      = REQ_ONE;
+  ends[0]   = ends[1] = -1;
+  part      = -1;
+  fence     = NO_FENCE;
+  needsBoss = false;
+  optional  = false;
+  timeoutMs = QUICK_TIMEOUT;
+  target    = 0;
+  take      = 0x0;
+}
+
+standClient::request::request(const char *line, int end0, int end1) {
+  snprintf(text, sizeof(text), "%s\n", line);
+  kind      = REQ_ONE;
+  ends[0]   = end0;
+  ends[1]   = end1;
+  part      = -1;
+  fence     = (end0 < 0) ? FENCE_AFTER_SEND : NO_FENCE;
+  needsBoss = false;
+  optional  = false;
+  timeoutMs = QUICK_TIMEOUT;
+  target    = 0;
+  take      = takeTrue;
+}
+
+standClient::standClient(eventLoop &l) : loop(l) {
+  fd        = -1;
+  baud      = BAUD;
+  awake     = AWAKE_UNKNOWN;
+  terse     = false;
+  inFlight  = false;
+  matched   = false;
+  phase     = 0;
+  sentAt    = 0;
+  holdUntil = 0;
+  ledIndex  = -1;
+  seq       = 0x0;
+  fencing   = false;
+  pings     = 0;
+  lastPing  = 0;
+  timeoutTimer = fenceTimer = holdTimer = 0;
+  rxLen     = 0;
+  txLen     = 0;
+  writeWanted = false;
+  busyMs    = 0;
+  bytesIn   = bytesOut = 0;
+  linesIn   = 0;
+  return;
+}
+
+standClient::~standClient(void) {
+  onClose = nullptr;
+  close();
+  return;
+}
+
+bool standClient::open( const char *dev, uint32_t rate, uint32_t bootMs ) {
+
+  if ( fd >= 0 )
+    close();
+
+  fd = openLine(dev, rate);
+  if ( fd < 0 )
+    return false;
+  if ( !loop.add(fd, this) ) {
+    ::close(fd);
+    fd = -1;
+    return false;
+  }
+
+  baud      = rate;
+  awake     = AWAKE_UNKNOWN;
+  rxLen     = txLen = 0;
+  holdUntil = eventLoop::nowMs() + bootMs;
+  return true;
+}
+
+// Everything outstanding fails, then the port goes
+void standClient::close(void) {
+
+  if ( fd < 0 )
+    return;
+
+  loop.remove(fd);
+  ::close(fd);
+  fd = -1;
+
+  loop.cancel(holdTimer);
+  holdTimer = 0;
+
+  finish(REPLY_CLOSED);
+  while ( !pending.empty() ) {
+    request req = pending.front();
+    pending.pop_front();
+    fail(req, REPLY_CLOSED);
+  }
+
+  if ( onClose )
+    onClose();
+  return;
+}
+
+void standClient::hangup(void) {
+  close();
+  return;
+}
+
+/***********************************************************************************************/
+
+reply<bool> standClient::identify(void) {
+  request req("i", MSG_IDENT);
+  return submit<bool>(req);
+}
+
+reply<bool> standClient::wake( unsigned type ) {
+  char line[16];
+  snprintf(line, sizeof(line), "G %u", type);
+  request req(line, MSG_AWAKE);
+  req.timeoutMs = MOVE_TIMEOUT;       // it homes every axis first
+  return submit<bool>(req);
+}
+
+reply<bool> standClient::sleep(void) {
+  request req("g", MSG_ASLEEP, MSG_SLEEPING);
+  req.timeoutMs = MOVE_TIMEOUT;
+  return submit<bool>(req);
+}
+
+reply<unsigned> standClient::setType( unsigned type ) {
+  char line[16];
+  snprintf(line, sizeof(line), "T %u", type);
+  request req(line, MSG_ODU_TYPE);
+  req.take      = takeType;
+  req.needsBoss = true;
+  return submit<unsigned>(req);
+}
+
+reply<bool> standClient::moveTo( unsigned connector ) {
+  char line[16];
+  snprintf(line, sizeof(line), "m %u", connector);
+  request req(line, MSG_MOVED);
+  req.needsBoss = true;
+  req.timeoutMs = MOVE_TIMEOUT;
+  return submit<bool>(req);
+}
+
+reply<bool> standClient::home(void) {
+  request req("h", MSG_PARKED);
+  req.needsBoss = true;
+  req.timeoutMs = MOVE_TIMEOUT;
+  return submit<bool>(req);
+}
+
+// The ones that move without a word
+#define SILENT_MOVE(method, line)       \
+reply<bool> standClient::method(void) { \
+  request req(line);                    \
+  req.needsBoss = true;                 \
+  req.timeoutMs = MOVE_TIMEOUT;         \
+  return submit<bool>(req);             \
+}
+SILENT_MOVE(resetHome, "H")
+SILENT_MOVE(plugIn,    "I")
+SILENT_MOVE(unPlug,    "O")
+SILENT_MOVE(unlock,    "U")
+#undef SILENT_MOVE
+
+reply<bool> standClient::step( char axis, float steps ) {
+  char line[INPUT_SIZE];
+  snprintf(line, sizeof(line), "%c %.2f", axis | 0x20, steps);
+  request req(line);
+  req.needsBoss = true;
+  req.timeoutMs = MOVE_TIMEOUT;
+  return submit<bool>(req);
+}
+
+reply<bool> standClient::rotate( float degrees ) {
+  char line[INPUT_SIZE];
+  snprintf(line, sizeof(line), "R %.2f", degrees);
+  request req(line);
+  req.needsBoss = true;
+  req.timeoutMs = MOVE_TIMEOUT;
+  return submit<bool>(req);
+}
+
+reply<headPosition> standClient::position(void) {
+  request req("p", MSG_HEAD_AT);
+  req.take      = takeHead;
+  req.needsBoss = true;
+  return submit<headPosition>(req);
+}
+
+reply<driftReport> standClient::drift(void) {
+  request req("E", MSG_DRIFT_COUNT);
+  req.take      = takeDrift;
+  req.needsBoss = true;
+  return submit<driftReport>(req);
+}
+
+reply<axisSpeeds> standClient::speeds(void) {
+  request req("u", MSG_SPEEDS);
+  req.take      = takeSpeeds;
+  req.needsBoss = true;
+  return submit<axisSpeeds>(req);
+}
+
+reply<unsigned> standClient::tune( char axis ) {
+  char line[8];
+  snprintf(line, sizeof(line), "u %c", axis);
+  request req(line, MSG_TUNED, MSG_NO_MOTOR);
+  req.take      = takeTuned;
+  req.needsBoss = true;
+  req.timeoutMs = ODU_TIMEOUT;
+  return submit<unsigned>(req);
+}
+
+reply<sequenceResult> standClient::sequence(void) {
+  request req("s", MSG_DONE);
+  req.kind      = REQ_SEQUENCE;
+  req.take      = 0x0;
+  req.timeoutMs = MOVE_TIMEOUT;
+  return submit<sequenceResult>(req);
+}
+
+reply<oduResult> standClient::testODU( uint32_t mask, connectorFn each ) {
+  char line[INPUT_SIZE];
+  snprintf(line, sizeof(line), "F 0x%lX", (unsigned long)mask);
+  request req(line, MSG_ODU_DONE, MSG_ODU_ABORTED);
+  req.kind      = REQ_ODU;
+  req.take      = 0x0;
+  req.needsBoss = true;
+  req.timeoutMs = ODU_TIMEOUT;
+  req.each      = each;
+  return submit<oduResult>(req);
+}
+
+// With the boss awake the stand parks after "c4", so that's fenced too
+// One line per channel and nothing after them, so it's fenced
+reply<normalizationSet> standClient::normalizations(void) {
+  request req("N", MSG_NORM);
+  req.take     = takeNorm;
+  req.fence    = FENCE_AFTER_SEND;
+  req.optional = true;
+  return submit<normalizationSet>(req);
+}
+
+reply<mapReading> standClient::readMap( unsigned type ) {
+  char line[16];
+  snprintf(line, sizeof(line), "V %u", type);
+  request req(line, MSG_MAP);
+  req.part = MSG_MAP_ENTRY;
+  req.take = takeMap;
+  return submit<mapReading>(req);
+}
+
+// The map's bytes 8 to a 'W', each answered before the next goes, then
+// the 'w' with their CRC. A piece that doesn't land fails the CRC, so
+// only the last reply says anything
+reply<bool> standClient::writeMap( unsigned type, const connectorMap &map ) {
+
+  const uint8_t *bytes = (const uint8_t *)&map;
+  uint16_t crc = 0xFFFF;
+  char line[INPUT_SIZE];
+
+  for ( unsigned at=0; at<sizeof(map); at+=8 ) {
+    int len = snprintf(line, sizeof(line), "W %u %u ", type, at);
+    for ( unsigned i=at; i<at+8 && i<sizeof(map); i++ ) {
+      len += snprintf(line + len, sizeof(line) - len, "%02x", bytes[i]);
+      crc = _crc_ccitt_update(crc, bytes[i]);
+    }
+    request req(line, MSG_MAP_STAGED, MSG_MAP_REJECTED);
+    submit<bool>(req);
+  }
+
+  snprintf(line, sizeof(line), "w %u %x", type, crc);
+  request req(line, MSG_MAP_SAVED, MSG_MAP_REJECTED);
+  req.take = takeSaved;
+  return submit<bool>(req);
+}
+
+reply<bool> standClient::calibrate(void) {
+  request req("C", MSG_CALIBRATED);
+  req.fence     = FENCE_AFTER_END;
+  req.timeoutMs = MOVE_TIMEOUT;
+  return submit<bool>(req);
+}
+
+reply<unsigned> standClient::setDelay( unsigned ms ) {
+  char line[16];
+  snprintf(line, sizeof(line), "D %u", ms);
+  request req(line, MSG_DELAY_SET);
+  req.take = takeNumber;
+  return submit<unsigned>(req);
+}
+
+reply<bool> standClient::setSubtract( bool on ) {
+  request req(on ? "b 1" : "b 0", MSG_SUBTRACT);
+  req.take = takeOn;
+  return submit<bool>(req);
+}
+
+reply<bool> standClient::setSlide( bool on ) {
+  request req(on ? "f 1" : "f 0", MSG_SLIDE);
+  req.take      = takeOn;
+  req.needsBoss = true;
+  return submit<bool>(req);
+}
+
+reply<bool> standClient::setPrefetch( bool on ) {
+  request req(on ? "o 1" : "o 0", MSG_PREFETCH);
+  req.take = takeOn;
+  return submit<bool>(req);
+}
+
+reply<unsigned> standClient::setLEDs( unsigned leds ) {
+  char line[16];
+  snprintf(line, sizeof(line), "n %u", leds);
+  request req(line, MSG_NUM_LEDS);
+  req.take = takeNumber;
+  return submit<unsigned>(req);
+}
+
+reply<unsigned> standClient::setSamples( unsigned samples ) {
+  char line[16];
+  snprintf(line, sizeof(line), "S %u", samples);
+  request req(line, MSG_SAMPLES);
+  req.take = takeNumber;
+  return submit<unsigned>(req);
+}
+
+// "171 Telemetry off" has no number, so that's a 0
+reply<unsigned> standClient::setTelemetry( unsigned ms ) {
+  char line[16];
+  snprintf(line, sizeof(line), "P %u", ms);
+  request req(line, MSG_TELEMETRY, MSG_TELEMETRY_OFF);
+  req.take = takeNumber;
+  return submit<unsigned>(req);
+}
+
+reply<bool> standClient::toggleTerse(void) {
+  request req("v", MSG_TERSE);
+  req.take = takeOn;
+  return submit<bool>(req);
+}
+
+reply<bool> standClient::clearFaults(void) {
+  request req("c", MSG_CRASH_CLEARED, MSG_FATAL_CLEARED);
+  req.fence    = FENCE_AFTER_SEND;
+  req.optional = true;
+  return submit<bool>(req);
+}
+
+reply<uint32_t> standClient::setBaud( uint32_t rate ) {
+  char line[16];
+  snprintf(line, sizeof(line), "B %lu", (unsigned long)rate);
+  request req(line, MSG_BAUD);
+  req.kind      = REQ_BAUD;
+  req.take      = 0x0;
+  req.target    = rate;
+  req.timeoutMs = QUICK_TIMEOUT + BAUD_TIMEOUT;
+  return submit<uint32_t>(req);
+}
+
+reply<bool> standClient::command( const char *text, int end, uint32_t timeoutMs ) {
+  request req(text, end);
+  req.timeoutMs = timeoutMs;
+  return submit<bool>(req);
+}
+
+// 'S' stops a move like 's' does, but on an idle stand it's only a
+// sample size the firmware turns down, where 's' would run a sequence
+void standClient::stop(void) {
+  if ( fd < 0 || !inFlight )
+    return;
+  write("S\n");
+  settle();
+  return;
+}
+
+/***********************************************************************************************/
+
+void standClient::enqueue( request &req ) {
+  if ( fd < 0 ) {
+    fail(req, REPLY_CLOSED);
+    return;
+  }
+  pending.push_back(req);
+  kick();
+  return;
+}
+
+// Send the next command, if the stand is ready for it
+void standClient::kick(void) {
+
+  if ( fd < 0 || inFlight || pending.empty() )
+    return;
+
+  // Give any late 'i' its chance to be answered before the line is shared
+  uint64_t now = eventLoop::nowMs(), hold = holdUntil;
+  if ( pings ) {
+    if ( now >= lastPing + FENCE_SETTLE )
+      pings = 0;
+    else if ( hold < lastPing + FENCE_SETTLE )
+      hold = lastPing + FENCE_SETTLE;
+  }
+  if ( now < hold ) {
+    if ( !holdTimer )
+      holdTimer = loop.after(hold - now, [this]() { holdTimer = 0; kick(); });
+    return;
+  }
+
+  cur = pending.front();
+  pending.pop_front();
+  inFlight = true;
+  sentAt   = now;
+  matched  = false;
+  phase    = 0;
+  ledIndex = -1;
+  seq      = 0x0;
+
+  if ( cur.needsBoss && awake == AWAKE_NO ) {
+    finish(REPLY_FAILED);
+    return;
+  }
+
+  if ( cur.kind == REQ_SEQUENCE )
+    seq = &static_cast<replyState<sequenceResult> *>(cur.core.get())->value;
+
+  write(cur.text);
+  timeoutTimer = loop.after(cur.timeoutMs, [this]() { timeoutTimer = 0; settle(); finish(REPLY_TIMEOUT); });
+  if ( cur.fence == FENCE_AFTER_SEND )
+    startFence(FENCE_FIRST);
+  return;
+}
+
+void standClient::fail( request &req, replyStatus status ) {
+  req.core->status = status;
+  std::function<void(void)> fn;
+  fn.swap(req.core->done);
+  if ( fn )
+    fn();
+  return;
+}
+
+// The command at the stand is over, one way or another
+void standClient::finish( replyStatus status ) {
+
+  if ( !inFlight )
+    return;
+
+  loop.cancel(timeoutTimer);
+  loop.cancel(fenceTimer);
+  timeoutTimer = fenceTimer = 0;
+  fencing  = false;
+  inFlight = false;
+  busyMs  += eventLoop::nowMs() - sentAt;
+
+  // A baud change that didn't take leaves the board where it was
+  if ( cur.kind == REQ_BAUD && status != REPLY_DONE && phase && fd >= 0 )
+    setLine(fd, baud);
+
+  request done = cur;
+  cur.core.reset();
+  cur.each = nullptr;
+  seq = 0x0;
+
+  fail(done, status);
+  kick();
+  return;
+}
+
+// A command that ended without its answer may still be in the Uno's
+// RX buffer, and the next one mustn't land on top of it there
+void standClient::settle(void) {
+  uint64_t until = eventLoop::nowMs() + FENCE_SETTLE;
+  if ( holdUntil < until )
+    holdUntil = until;
+  return;
+}
+
+void standClient::startFence( uint32_t ms ) {
+  if ( fencing )
+    return;
+  fencing    = true;
+  fenceTimer = loop.after(ms, [this]() { fenceTimer = 0; ping(); });
+  return;
+}
+
+void standClient::ping(void) {
+  if ( !inFlight || !fencing )
+    return;
+  write("i\n");
+  pings++;
+  lastPing   = eventLoop::nowMs();
+  fenceTimer = loop.after(FENCE_EVERY, [this]() { fenceTimer = 0; ping(); });
+  return;
+}
+
+/***********************************************************************************************/
+
+// Cut what's arrived into lines and act on each, in place
+void standClient::readable(void) {
+
+  while ( fd >= 0 ) {
+    ssize_t n = ::read(fd, rx + rxLen, sizeof(rx) - 1 - rxLen);
+    if ( n < 0 && (errno == EAGAIN || errno == EINTR) )
+      return;
+    if ( n <= 0 ) {
+      if ( n < 0 )
+        hangup();
+      return;
+    }
+    bytesIn += n;
+    rxLen   += n;
+
+    char *start = rx, *end = rx + rxLen, *nl;
+    while ( (nl = (char *)memchr(start, '\n', end - start)) ) {
+      *nl = '\0';
+      if ( nl > start && nl[-1] == '\r' )
+        nl[-1] = '\0';
+      handle(start);
+      if ( fd < 0 )
+        return;
+      start = nl + 1;
+    }
+
+    // Keep the partial line. One longer than the buffer is noise
+    rxLen = end - start;
+    if ( rxLen == sizeof(rx) - 1 )
+      rxLen = 0;
+    memmove(rx, start, rxLen);
+  }
+  return;
+}
+
+void standClient::handle( const char *text ) {
+
+  standLine line;
+  parseLine(text, &line);
+  linesIn++;
+
+  if ( onLine )
+    onLine(line);
+
+  switch ( line.id ) {
+  case LINE_TELEMETRY:
+    if ( onTelemetry ) {
+      telemetryFrame frame;
+      if ( parseTelemetry(text, &frame) )
+        onTelemetry(frame);
+    }
+    return;
+
+  case MSG_READY:
+    // A reset: whatever was at the stand is gone, and the boss with it
+    awake     = AWAKE_NO;
+    terse     = false;
+    pings     = 0;
+    holdUntil = eventLoop::nowMs();
+    if ( inFlight ) {
+      settle();
+      finish(REPLY_FAILED);
+    }
+    else
+      kick();
+    return;
+
+  case MSG_AWAKE:
+    awake = AWAKE_YES;
+    break;
+  case MSG_ASLEEP: case MSG_SLEEPING:
+    awake = AWAKE_NO;
+    break;
+  case MSG_TERSE:
+    terse = argIs(line, "on");
+    break;
+
+  case MSG_IDENT:
+    // The answer to a fence's 'i' is the fence's, not identify()'s
+    if ( pings ) {
+      pings--;
+      if ( inFlight && fencing )
+        finish((matched || cur.optional || cur.ends[0] < 0) ? REPLY_DONE : REPLY_FAILED);
+      else
+        kick();
+      return;
+    }
+    break;
+
+  case MSG_PANIC: case MSG_LIGHT_LEAK: case MSG_LED_ABORTED:
+    if ( inFlight ) {
+      if ( cur.core->fault < 0 )
+        cur.core->fault = line.id;
+      // Whatever it was doing is over, so there may be no "c4" coming
+      if ( cur.fence == FENCE_AFTER_END )
+        startFence(FENCE_FIRST);
+    }
+    break;
+  }
+
+  if ( isFault(line.id) && onFault )
+    onFault(line);
+
+  if ( inFlight )
+    progress(line);
+  return;
+}
+
+void standClient::addLED( sequenceResult *s, const standLine &line ) {
+  if ( !s || ledIndex < 0 || s->count >= MAX_LEDS )
+    return;
+  ledResult &led = s->leds[s->count++];
+  led.led = ledIndex;
+  ledFromLine(line, &led);
+  ledIndex = -1;
+  return;
+}
+
+// What <line> means to the command at the stand
+void standClient::progress( const standLine &line ) {
+
+  if ( cur.kind == REQ_BAUD ) {
+    progressBaud(line);
+    return;
+  }
+
+  if ( cur.kind == REQ_SEQUENCE || cur.kind == REQ_ODU ) {
+    oduResult *odu = (cur.kind == REQ_ODU) ? &static_cast<replyState<oduResult> *>(cur.core.get())->value : 0x0;
+
+    switch ( line.id ) {
+    case MSG_CONNECTOR:
+      if ( odu && line.num[0] >= 1 && line.num[0] <= NUM_CONNECTORS ) {
+        seq = &odu->connectors[line.num[0] - 1];
+        seq->count = 0;
+      }
+      return;
+    case MSG_LED_START:
+      ledIndex = line.num[1];
+      return;
+    case MSG_LED_DATA:
+      addLED(seq, line);
+      return;
+    case MSG_DONE:
+      if ( !odu ) {
+        finish(cur.core->fault < 0 ? REPLY_DONE : REPLY_FAILED);
+        return;
+      }
+      if ( seq ) {
+        unsigned connector = seq - odu->connectors + 1;
+        odu->mask |= 1UL << (connector - 1);
+        if ( cur.each )
+          cur.each(connector, *seq);
+      }
+      seq = 0x0;
+      return;
+    case MSG_ODU_DONE:
+      finish(cur.core->fault < 0 ? REPLY_DONE : REPLY_FAILED);
+      return;
+    case MSG_ODU_ABORTED:
+      if ( odu )
+        odu->aborted = line.num[0];
+      finish(REPLY_FAILED);
+      return;
+    }
+    return;
+  }
+
+  if ( line.id >= 0 && line.id == cur.part ) {
+    if ( cur.take )
+      cur.take(cur.core.get(), line);
+    return;
+  }
+  if ( line.id < 0 || (line.id != cur.ends[0] && line.id != cur.ends[1]) )
+    return;
+
+  if ( cur.take )
+    cur.take(cur.core.get(), line);
+  matched = true;
+
+  if ( cur.fence == FENCE_AFTER_END )
+    startFence(FENCE_FIRST);
+  else if ( cur.fence == NO_FENCE )
+    finish(REPLY_DONE);
+  return;
+}
+
+/*
+ * 'B': "15 Baud n" at the old rate, then the board switches and waits
+ * for a 'B' at the new one, and says "15 Baud n" again once it has it
+ */
+void standClient::progressBaud( const standLine &line ) {
+
+  uint32_t &value = static_cast<replyState<uint32_t> *>(cur.core.get())->value;
+
+  switch ( line.id ) {
+  case MSG_BAUD:
+    if ( phase == 0 && (uint32_t)line.num[0] == cur.target ) {
+      phase = 1;
+      setLine(fd, cur.target);
+      write("B\n");
+    }
+    else if ( phase == 1 ) {
+      baud  = cur.target;
+      value = baud;
+      finish(REPLY_DONE);
+    }
+    return;
+  case MSG_BAD_BAUD:
+    value = baud;
+    finish(REPLY_FAILED);
+    return;
+  case MSG_BAUD_FALLBACK:
+    value = line.num[0];
+    finish(REPLY_FAILED);
+    return;
+  }
+  return;
+}
+
+/***********************************************************************************************/
+
+void standClient::write( const char *text ) {
+  size_t len = strlen(text);
+  if ( fd < 0 || txLen + len > sizeof(tx) )
+    return;
+  memcpy(tx + txLen, text, len);
+  txLen += len;
+  flush();
+  return;
+}
+
+void standClient::writable(void) {
+  flush();
+  return;
+}
+
+void standClient::flush(void) {
+
+  while ( txLen && fd >= 0 ) {
+    ssize_t n = ::write(fd, tx, txLen);
+    if ( n < 0 && errno == EINTR )
+      continue;
+    if ( n <= 0 ) {
+      if ( n < 0 && errno != EAGAIN ) {
+        hangup();
+        return;
+      }
+      if ( !writeWanted )
+        loop.wantWrite(fd, this, true);
+      writeWanted = true;
+      return;
+    }
+    bytesOut += n;
+    txLen    -= n;
+    memmove(tx, tx + n, txLen);
+  }
+
+  if ( writeWanted && fd >= 0 )
+    loop.wantWrite(fd, this, false);
+  writeWanted = false;
+  return;
+}
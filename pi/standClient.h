@@ -0,0 +1,291 @@
+#ifndef STANDCLIENT_H
+#define STANDCLIENT_H
+
+#include <stdint.h>
+#include <deque>
+#include <memory>
+#include <functional>
+#include "eventLoop.h"
+#include "protocol.h"
+#include "../config.h"
+#include "../connectorMap.h"
+
+/*
+ * The host side of the stand's serial protocol, for the Pi. One
+ * standClient per stand, any number of them on one eventLoop.
+ *
+ * Every command returns a reply<T> straight away, and the reply fills
+ * in when the stand has answered: moveTo() when "09 Move Complete" comes
+ * back, sequence() with the 18 LEDs' numbers when "04 done" does. Ask it
+ * with ready()/status()/get(), have then() call you, or wait() for it.
+ *
+ * The firmware takes one line per loop() and throws away whatever
+ * arrives while the motors are moving (only a stop is looked at), so
+ * only one command is ever at the stand. The rest queue here and each
+ * goes the moment the one before it has answered, which leaves it
+ * sitting in the Uno's RX buffer for the next loop() rather than
+ * waiting on a round trip through the Pi.
+ *
+ * Some commands ('x', 'U', 'I', ...) never answer, and 'C' goes on
+ * moving after its last line. Those are fenced: an 'i' goes every
+ * FENCE_EVERY ms (any that land mid move are eaten) until "01 ODUQC"
+ * comes back, and only then is the command done.
+ */
+
+#define CLIENT_BOOT      2500     // ms a freshly opened Uno takes to say "00 Ready"
+#define FENCE_FIRST      100      // ms from the command to the first 'i'
+#define FENCE_EVERY      250      // and between them
+#define FENCE_SETTLE     600      // ms to let a late 'i' be answered before the next command
+
+#define QUICK_TIMEOUT    5000     // ms, settings and the like
+#define MOVE_TIMEOUT     120000   // anything that moves a motor
+#define ODU_TIMEOUT      3600000  // a whole ODU
+
+#define MAX_LEDS         18
+
+enum replyStatus {
+  REPLY_PENDING,                  // not back yet
+  REPLY_DONE,                     // the stand did it
+  REPLY_FAILED,                   // it couldn't, or it was cut short
+  REPLY_TIMEOUT,                  // it didn't answer in time
+  REPLY_CLOSED                    // the line went away first
+};
+
+struct sequenceResult {
+  uint8_t   count;
+  ledResult leds[MAX_LEDS];
+};
+
+struct oduResult {
+  uint32_t       mask;            // connectors that finished (bit 0 == connector 1)
+  uint8_t        aborted;         // where it stopped, 0 if it didn't
+  sequenceResult connectors[NUM_CONNECTORS];
+};
+
+struct headPosition {
+  float x, y, z, r;
+};
+
+// Step rates (rpm), per axis X Y Z R
+struct axisSpeeds {
+  unsigned rpm[4];
+};
+
+// Lost steps the limit switches have caught, per axis X Y Z R
+struct driftReport {
+  unsigned corrections[4];
+  int      last[4];               // steps the count was out the last time
+};
+
+struct normalizationSet {
+  uint8_t count;                  // channels the stand reported
+  float   value[MAX_LEDS];
+};
+
+struct mapReading {
+  uint8_t      type;              // 1 odd, 2 even
+  uint8_t      count;             // entries that came back
+  connectorMap map;
+  uint16_t     crc;               // the stand's, over the whole map
+  int          slot;              // -1 for the built in map
+  uint32_t     sequence;
+};
+
+// What the client and a reply<> share
+struct replyCore {
+  replyCore(void) : status(REPLY_PENDING), fault(-1) {}
+  virtual ~replyCore(void) {}
+
+  replyStatus               status;
+  int                       fault;   // first fd/fe/fe1 while it ran, -1 if none
+  std::function<void(void)> done;
+};
+
+template <class T> struct replyState : replyCore {
+  replyState(void) : value() {}
+  T value;
+};
+
+template <class T> class reply {
+
+ public:
+  reply(void) {}
+  reply(std::shared_ptr< replyState<T> > s) : state(s) {}
+
+  bool        ready  ( void ) const {return status() != REPLY_PENDING;}
+  bool        ok     ( void ) const {return status() == REPLY_DONE;}
+  replyStatus status ( void ) const {return state ? state->status : REPLY_CLOSED;}
+  int         fault  ( void ) const {return state ? state->fault : -1;}
+  const T    &get    ( void ) const {return state->value;}
+
+  // Call <fn> when it's ready, or now if it already is
+  void then( std::function<void(const reply<T> &)> fn ) {
+    if ( !state )
+      return;
+    if ( ready() ) {
+      fn(*this);
+      return;
+    }
+    reply<T> self = *this;        // let go of when it fires
+    state->done = [fn, self]() { fn(self); };
+  }
+
+ private:
+  std::shared_ptr< replyState<T> > state;
+};
+
+typedef std::function<void(unsigned, const sequenceResult &)> connectorFn;
+
+class standClient : public pollable {
+
+ public:
+  standClient(eventLoop &loop);
+  ~standClient(void);
+
+  // <bootMs> holds the first command until the board has had time to
+  // reset (opening an Uno's port resets it); "00 Ready" ends it early
+  bool   open               ( const char *dev, uint32_t baud = BAUD, uint32_t bootMs = CLIENT_BOOT );
+  void   close              ( void );
+  bool   isOpen             ( void ) const {return fd >= 0;}
+
+  reply<bool>           identify     ( void );
+  reply<bool>           wake         ( unsigned type );
+  reply<bool>           sleep        ( void );
+  reply<unsigned>       setType      ( unsigned type );          // 1 odd, 2 even
+  reply<bool>           moveTo       ( unsigned connector );
+  reply<bool>           home         ( void );
+  reply<bool>           resetHome    ( void );
+  reply<bool>           plugIn       ( void );
+  reply<bool>           unPlug       ( void );
+  reply<bool>           unlock       ( void );
+  reply<bool>           step         ( char axis, float steps );
+  reply<bool>           rotate       ( float degrees );
+  reply<headPosition>   position     ( void );
+  reply<driftReport>    drift        ( void );
+  reply<axisSpeeds>     speeds       ( void );
+  reply<unsigned>       tune         ( char axis );               // the rpm it kept
+  reply<sequenceResult> sequence     ( void );
+  reply<normalizationSet> normalizations ( void );
+  reply<mapReading>     readMap      ( unsigned type );
+  reply<bool>           writeMap     ( unsigned type, const connectorMap &map );  // true if it was kept
+  reply<oduResult>      testODU      ( uint32_t mask = ALL_CONNECTORS, connectorFn each = nullptr );
+  reply<bool>           calibrate    ( void );
+  reply<unsigned>       setDelay     ( unsigned ms );
+  reply<bool>           setSubtract  ( bool on );
+  reply<bool>           setSlide     ( bool on );
+  reply<bool>           setPrefetch  ( bool on );
+  reply<unsigned>       setLEDs      ( unsigned leds );
+  reply<unsigned>       setSamples   ( unsigned samples );
+  reply<unsigned>       setTelemetry ( unsigned ms );           // 0 is off
+  reply<bool>           toggleTerse  ( void );
+  reply<bool>           clearFaults  ( void );                  // true if there was one
+  reply<uint32_t>       setBaud      ( uint32_t baud );         // the rate it ended up at
+
+  // Anything else: done at message <end>, or fenced if that's -1
+  reply<bool>           command      ( const char *text, int end = -1, uint32_t timeoutMs = QUICK_TIMEOUT );
+
+  // Stop the move in progress. Sent now, not queued
+  void   stop               ( void );
+
+  template <class T> const reply<T> &wait( const reply<T> &r ) {
+    while ( !r.ready() && loop.runOnce() )
+      ;
+    return r;
+  }
+
+  size_t   queued           ( void ) const {return pending.size() + (inFlight ? 1 : 0);}
+  bool     busy             ( void ) const {return inFlight;}
+  bool     isTerse          ( void ) const {return terse;}
+  uint32_t getBaud          ( void ) const {return baud;}
+
+  // Every line, then the ones worth their own hook
+  std::function<void(const standLine &)>      onLine;
+  std::function<void(const telemetryFrame &)> onTelemetry;
+  std::function<void(const standLine &)>      onFault;      // the 'f' codes
+  std::function<void(void)>                   onClose;
+
+  // Counters, for the daemon's utilization numbers
+  uint64_t busyMs;                // with a command at the stand
+  uint64_t bytesIn, bytesOut;
+  uint64_t linesIn;
+
+  void   readable           ( void );
+  void   writable           ( void );
+  void   hangup             ( void );
+
+ private:
+  enum { REQ_ONE, REQ_SEQUENCE, REQ_ODU, REQ_BAUD };
+  enum { NO_FENCE, FENCE_AFTER_SEND, FENCE_AFTER_END };
+  enum { AWAKE_UNKNOWN, AWAKE_NO, AWAKE_YES };
+
+  struct request {
+    request(void);
+    request(const char *line, int end0 = -1, int end1 = -1);
+
+    char        text[INPUT_SIZE+2];
+    uint8_t     kind;
+    int8_t      ends[2];          // either of these answers it
+    int8_t      part;             // lines that go to take on the way there
+    uint8_t     fence;
+    bool        needsBoss;        // nothing comes back from a sleeping stand
+    bool        optional;         // fenced, and fine without an answer
+    uint32_t    timeoutMs;
+    uint32_t    target;           // REQ_BAUD's rate
+    void      (*take)(replyCore *, const standLine &);
+    std::shared_ptr<replyCore> core;
+    connectorFn each;
+  };
+
+  template <class T> reply<T> submit( request &req ) {
+    std::shared_ptr< replyState<T> > state(new replyState<T>());
+    req.core = state;
+    enqueue(req);
+    return reply<T>(state);
+  }
+
+  void   enqueue            ( request &req );
+  void   kick               ( void );
+  void   finish             ( replyStatus status );
+  void   fail               ( request &req, replyStatus status );
+  void   settle             ( void );
+  void   startFence         ( uint32_t ms );
+  void   ping               ( void );
+
+  void   handle             ( const char *text );
+  void   progress           ( const standLine &line );
+  void   progressBaud       ( const standLine &line );
+  void   addLED             ( sequenceResult *seq, const standLine &line );
+
+  void   write              ( const char *text );
+  void   flush              ( void );
+
+  eventLoop           &loop;
+  int                  fd;
+  uint32_t             baud;
+  uint8_t              awake;
+  bool                 terse;
+
+  std::deque<request>  pending;
+  request              cur;
+  bool                 inFlight;
+  bool                 matched;     // cur's answer has been seen
+  uint8_t              phase;       // REQ_BAUD's progress
+  uint64_t             sentAt;
+  uint64_t             holdUntil;   // nothing goes before this
+  int                  ledIndex;    // from the last c1
+  sequenceResult      *seq;         // where the c2s go
+
+  bool                 fencing;
+  unsigned             pings;       // 'i's not yet answered
+  uint64_t             lastPing;
+
+  eventLoop::timerId   timeoutTimer, fenceTimer, holdTimer;
+
+  char                 rx[512];
+  size_t               rxLen;
+  char                 tx[256];
+  size_t               txLen;
+  bool                 writeWanted;
+};
+
+#endif
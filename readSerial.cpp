@@ -1,11 +1,14 @@
 #include "readSerial.h"
+#include "trace.h"
+#include "messages.h"
  
 readSerial::readSerial(void) {
-  Serial.begin(BAUD);     // set up Serial library
+  baud = BAUD;
+  Serial.begin(baud);     // set up Serial library
   while (!Serial);        // And wait until the line is initialized
 
-  // Allocate the memory for the command structure
-  cmd = new command;
+  // The command structure lives with us
+  cmd = &request;
 
   // Initialize the input buffer & counters & flags
   memset( input, '\0', (INPUT_SIZE+2)*sizeof(char) );
@@ -35,20 +38,25 @@ void readSerial::read(void) {
   if ( bytes <= 0 )
     return;
 
-  // Assign a buffer
-  char buffer[bytes+3];
+  TRACEPOINT('r');
+
+  // Take no more than the line can hold, the rest waits for next time
+  char buffer[INPUT_SIZE+3];
+  if ( bytes > INPUT_SIZE )
+    bytes = INPUT_SIZE;
 
   // And read the line. The return is the number of bytes read
   int size = Serial.readBytes( buffer, bytes );
   if ( size <= 0 )
     return;
+  buffer[size] = '\0';
 
   characters += size;
 
   if ( characters < INPUT_SIZE )
     strcat(input, buffer);
 
-  memset(buffer, '\0', sizeof(char)*(bytes+3));
+  memset(buffer, '\0', sizeof(buffer));
 
   if ( input[characters-1] == '\n' || input[characters-1] == '\r' ) {
     input[characters] = '\0';
@@ -101,3 +109,80 @@ char * readSerial::getInput( void ) {
   return cmd->input;
 }
 
+
+/*
+ * Switch the line to a new baud rate. The 16 MHz Uno divides 250000,
+ * 500000 and 1000000 exactly; 115200 comes out 2.1% fast (with U2X) but
+ * is the legacy rate everything starts at, so it's taken too. Nothing
+ * else is.
+ * After the switch the host has BAUD_TIMEOUT ms to send a 'B' at the
+ * new rate, otherwise we drop back to where we were.
+ */
+unsigned long readSerial::setBaud( unsigned long rate ) {
+
+  if ( rate != 115200 && rate != 250000 && rate != 500000 && rate != 1000000 ) {
+    say(MSG_BAD_BAUD);
+    return baud;
+  }
+
+  say(MSG_BAUD, rate);
+
+  // Let the reply drain at the old rate before pulling the rug out
+  Serial.flush();
+  Serial.end();
+  Serial.begin(rate);
+
+  // Wait for the host to confirm at the new rate
+  bool confirmed = false;
+  unsigned long start = millis();
+  while ( !confirmed && millis() - start < BAUD_TIMEOUT ) {
+    if ( Serial.available() && Serial.read() == 'B' )
+      confirmed = true;
+  }
+
+  if ( confirmed ) {
+    // Eat the rest of the confirmation line
+    delay(5);
+    while ( Serial.available() )
+      Serial.read();
+
+    baud = rate;
+    say(MSG_BAUD, rate);
+  }
+  else {
+    Serial.end();
+    Serial.begin(baud);
+    say(MSG_BAUD_FALLBACK, baud);
+  }
+
+  // Whatever was half read at the old rate is garbage now
+  memset( input, '\0', sizeof(char)*(INPUT_SIZE+2) );
+  characters = 0;
+  msgAvailable = false;
+
+  return baud;
+}
+
+// Push <bytes> of filler down the line and report how long it took
+void readSerial::throughput( uint bytes ) {
+
+  const char line[] = "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ.\n";
+  const uint len = sizeof(line) - 1;
+
+  Serial.flush();
+  unsigned long start = micros();
+
+  uint sent = 0;
+  while ( sent < bytes ) {
+    uint chunk = (bytes - sent < len) ? bytes - sent : len;
+    Serial.write((const uint8_t *)line + len - chunk, chunk);
+    sent += chunk;
+  }
+  Serial.flush();
+
+  unsigned long elapsed = micros() - start;
+
+  say(MSG_THROUGHPUT, sent, elapsed);
+  
+  return;
+}
@@ -14,7 +14,7 @@ struct command {
   float  steps     = 0;       // Steps to take
   char   input[INPUT_SIZE+2]; // Input the user (or program) entered
 };
-static command * cmd;
+extern command * cmd;
 
 // Accept input on the serial line and build the structure
 // which will tell the arduino what, exactly, to do
@@ -30,10 +30,19 @@ class readSerial {
 
   char * getInput( void );
 
+  unsigned long setBaud( unsigned long );
+  unsigned long getBaud( void ) {return baud;}
+  void throughput( uint );
+
   char input[INPUT_SIZE+2];
   unsigned int characters;
   bool msgAvailable;
+
+ private:
+  unsigned long baud;
+  command       request;      // what cmd points at
+
 };
-static readSerial * reader;
+extern readSerial * reader;
 #endif
 
@@ -0,0 +1,43 @@
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include <Arduino.h>
+
+/*
+ * Reserved storage for the objects that come and go (the motor boss
+ * and everything it owns on 'G'/'g') and the ones built in setup().
+ * The space is part of .bss, so it shows up in the build's size report
+ * and toggling GORT can't fragment a heap. The 1.8.5 core has no
+ * placement new, so slots use their own tagged one, which can't clash
+ * with the core's if it grows one.
+ */
+struct inPlace {};
+inline void *operator new( size_t, void *where, inPlace ) {return where;}
+
+template <class T> class staticSlot {
+
+ public:
+  staticSlot(void) : obj(0x0) {}
+
+  // Build the object in the slot, unless it's already there
+  template <class... Args> T *make( Args... args ) {
+    if ( !obj )
+      obj = new (store, inPlace()) T(args...);
+    return obj;
+  }
+
+  void destroy( void ) {
+    if ( obj )
+      obj->~T();
+    obj = 0x0;
+  }
+
+  T *get( void ) {return obj;}
+  static size_t size( void ) {return sizeof(T);}
+
+ private:
+  T *obj;
+  alignas(T) uint8_t store[sizeof(T)];
+};
+
+#endif
@@ -0,0 +1,107 @@
+#include "telemetry.h"
+#include "motorBoss.h"
+
+telemetry telem;
+
+telemetry::telemetry(void) {
+  boss    = 0x0;
+  cmd     = 0x0;
+  period  = 0;
+  last    = 0;
+  pending = 0;
+  frame[0] = '\0';
+  return;
+}
+
+// 0 turns the stream off, anything else is clamped to TELEMETRY_MIN ms
+uint telemetry::setPeriod( uint ms ) {
+  if ( ms && ms < TELEMETRY_MIN )
+    ms = TELEMETRY_MIN;
+  period  = ms;
+  pending = 0;
+  last    = millis();
+  return period;
+}
+
+void telemetry::attach( motorBoss *b ) {
+  boss = b;
+  return;
+}
+
+void telemetry::setCommand( command *c ) {
+  cmd = c;
+  return;
+}
+
+// Send a frame if one is due and the TX buffer can take it in one go
+bool telemetry::poll(void) {
+
+  if ( !period )
+    return false;
+
+  bool built = false;
+  if ( !pending ) {
+    if ( millis() - last < period )
+      return false;
+    last = millis();
+    buildFrame();
+    built = true;
+  }
+
+  // An empty buffer takes anything, even a frame longer than the buffer
+  int room = Serial.availableForWrite();
+  if ( room >= pending || room >= SERIAL_TX_BUFFER_SIZE - 1 ) {
+    Serial.write((const uint8_t *)frame, pending);
+    pending = 0;
+  }
+
+  return built;
+}
+
+// delay() that keeps the telemetry flowing
+void telemetry::wait( uint ms ) {
+  unsigned long start = millis();
+  while ( millis() - start < ms )
+    poll();
+  return;
+}
+
+/*
+ * t1 <millis> <x> <y> <z> <r> <limits> <light> <flags> <op>
+ * limits is a bit mask (X=1, Y=2, Z=4, R=8) of the tripped switches,
+ * flags has CRASH_STOP=1 and FATAL_ERROR=2, op is the current command
+ */
+void telemetry::buildFrame(void) {
+
+  int pos[4] = {0, 0, 0, 0};
+  const char axes[] = "XYZR";
+
+  if ( boss ) {
+    for ( int i=0; i<4; i++ ) {
+      axisMotor *motor = boss->getMotorPtr(axes[i]);
+      if ( motor )
+        pos[i] = (int)motor->getPosition();
+    }
+  }
+
+  byte limits = 0;
+  if ( pinHigh<XInputPin>() ) limits |= 1;
+  if ( pinHigh<YInputPin>() ) limits |= 2;
+  if ( pinHigh<ZInputPin>() ) limits |= 4;
+  if ( pinHigh<RInputPin>() ) limits |= 8;
+
+  byte flags = 0;
+  if ( CRASH_STOP )  flags |= 1;
+  if ( FATAL_ERROR ) flags |= 2;
+
+  char op = ( cmd && cmd->operation ) ? cmd->operation : '-';
+
+  pending = snprintf(frame, TELEMETRY_SIZE, "t1 %lu %i %i %i %i %u %u %u %c\r\n",
+                     last, pos[0], pos[1], pos[2], pos[3],
+                     limits, analogRead(photoPin), flags, op);
+
+  if ( pending >= TELEMETRY_SIZE )
+    pending = TELEMETRY_SIZE - 1;
+
+  return;
+}
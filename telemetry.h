@@ -0,0 +1,42 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <Arduino.h>
+#include "readSerial.h"
+#include "config.h"
+
+class motorBoss;
+
+// Opt-in periodic status frames so the host can follow the robot
+// without polling 'p'. Frames are only handed to the serial port when
+// the whole line fits in the TX buffer, so poll() never blocks and never
+// splits a frame across someone else's output.
+class telemetry {
+
+ public:
+  telemetry                  ( void );
+
+  uint    setPeriod          ( uint );
+  uint    getPeriod          ( void ) {return period;}
+
+  void    attach             ( motorBoss * );
+  void    setCommand         ( command * );
+
+  // True if it built a frame, which reads photoPin on the ADC
+  bool    poll               ( void );
+  void    wait               ( uint );
+
+ private:
+  void    buildFrame         ( void );
+
+  motorBoss     *boss;
+  command       *cmd;
+
+  uint          period;
+  unsigned long last;
+
+  char          frame[TELEMETRY_SIZE];
+  byte          pending;
+};
+extern telemetry telem;
+#endif
@@ -0,0 +1,39 @@
+#include "trace.h"
+
+#ifdef TRACE
+traceEvent traceRing[TRACE_SIZE];
+byte       traceHead    = 0;
+bool       traceWrapped = false;
+
+/*
+ * t2 <events> <micros of the first>
+ * t3 <id><us since the previous event> ... (8 to a line)
+ */
+void traceDump( void ) {
+  byte count = traceWrapped ? TRACE_SIZE : traceHead;
+  byte first = traceWrapped ? traceHead : 0;
+  char msg[16];
+
+  sprintf(msg, "t2 %u ", count);
+  Serial.print(msg);
+  Serial.println(count ? traceRing[first].t : 0);
+
+  unsigned long last = traceRing[first].t;
+  for ( byte i=0; i<count; i++ ) {
+    const traceEvent &e = traceRing[(first + i) & (TRACE_SIZE - 1)];
+
+    if ( i % 8 == 0 )
+      Serial.print(F("t3"));
+    sprintf(msg, " %c%lu", e.id, e.t - last);
+    Serial.print(msg);
+    if ( i % 8 == 7 || i == count - 1 )
+      Serial.println();
+
+    last = e.t;
+  }
+
+  traceHead    = 0;
+  traceWrapped = false;
+  return;
+}
+#endif
@@ -0,0 +1,52 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Arduino.h>
+#include "config.h"
+
+/*
+ * Hot path tracepoints. Build with -DTRACE and each TRACEPOINT(id) drops
+ * the event id and micros() into a small ring in SRAM, keeping the last
+ * TRACE_SIZE events; 'd' dumps and clears it. Without TRACE they compile
+ * to nothing. Ids are single characters so the dump reads at a glance:
+ *
+ *   X Y Z R   one step on that axis      C   checkContinueStatus
+ *   L         sequence starts an LED     A   one diode sample
+ *   U         updateRegisters            r   readSerial::read with data
+ */
+#ifndef TRACE_SIZE
+#define TRACE_SIZE 64            // must be a power of two, 128 at most
+#endif
+
+#ifdef TRACE
+struct traceEvent {
+  char          id;
+  unsigned long t;
+};
+
+// traceHead and traceDump()'s count are bytes, which is all the hot
+// path wants, and they have to hold TRACE_SIZE itself
+static_assert(TRACE_SIZE <= 128 && !(TRACE_SIZE & (TRACE_SIZE - 1)),
+              "TRACE_SIZE must be a power of two, 128 at most");
+
+extern traceEvent traceRing[TRACE_SIZE];
+extern byte       traceHead;
+extern bool       traceWrapped;
+
+inline void traceAdd( char id ) {
+  traceEvent &e = traceRing[traceHead];
+  e.t  = micros();
+  e.id = id;
+  traceHead = (traceHead + 1) & (TRACE_SIZE - 1);
+  if ( !traceHead )
+    traceWrapped = true;
+}
+
+void traceDump( void );
+
+#define TRACEPOINT(id) traceAdd(id)
+#else
+#define TRACEPOINT(id)
+#endif
+
+#endif